@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QList>
+#include <QPair>
+#include <QRegExp>
+#include <QRegularExpression>
+#include <QTest>
+
+#include <QHttpEngine/QHttpHandler>
+#include <QHttpEngine/QHttpSocket>
+
+#include "common/qsocketpair.h"
+
+#include "qallocationcounter.h"
+
+typedef QPair<QRegExp, QHttpHandler*> SubHandler;
+
+enum Mode {
+    Linear,
+    Literal,
+    RegExp,
+    RegularExpression
+};
+
+Q_DECLARE_METATYPE(Mode)
+
+class NullHandler : public QHttpHandler
+{
+    Q_OBJECT
+
+protected:
+
+    virtual void process(QHttpSocket *, const QString &) {}
+};
+
+class BenchQHttpHandler : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase_data();
+
+    void benchRoute_data();
+    void benchRoute();
+};
+
+void BenchQHttpHandler::initTestCase_data()
+{
+    QBENCHMARK_ALLOCATIONS_DATA();
+}
+
+void BenchQHttpHandler::benchRoute_data()
+{
+    QTest::addColumn<Mode>("mode");
+    QTest::addColumn<int>("count");
+
+    foreach (int count, QList<int>() << 10 << 100 << 500) {
+        QTest::newRow(qPrintable(QString("linear scan, %1 routes").arg(count))) << Linear << count;
+        QTest::newRow(qPrintable(QString("literal routes, %1 routes").arg(count))) << Literal << count;
+        QTest::newRow(qPrintable(QString("regexp routes, %1 routes").arg(count))) << RegExp << count;
+        QTest::newRow(qPrintable(QString("regular expression routes, %1 routes").arg(count))) << RegularExpression << count;
+    }
+}
+
+void BenchQHttpHandler::benchRoute()
+{
+    QFETCH_GLOBAL(bool, allocations);
+    QFETCH(Mode, mode);
+    QFETCH(int, count);
+
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QHttpSocket socket(pair.server(), &pair);
+
+    // The requested path matches the last route added, which is the worst
+    // case for a linear scan
+    NullHandler subHandler;
+    QHttpHandler handler;
+    QList<SubHandler> subHandlers;
+    for (int i = 0; i < count; ++i) {
+        QString source = mode == RegExp || mode == RegularExpression ?
+                QString("^api/v1/resource%1/(?=\\w)").arg(i) :
+                QString("^api/v1/resource%1/").arg(i);
+        if (mode == RegularExpression) {
+            handler.addSubHandler(QRegularExpression(source), &subHandler);
+        } else {
+            handler.addSubHandler(QRegExp(source), &subHandler);
+        }
+        subHandlers.append(SubHandler(QRegExp(source), &subHandler));
+    }
+    const QString path = QString("api/v1/resource%1/item").arg(count - 1);
+
+    if (mode == Linear) {
+
+        // This is the linear scan that QHttpHandler::route() used before
+        // routes were compiled into a trie
+        QBENCHMARK_ALLOCATIONS(allocations) {
+            foreach (SubHandler subHandler, subHandlers) {
+                if (subHandler.first.indexIn(path) != -1) {
+                    subHandler.second->route(&socket, path.mid(subHandler.first.matchedLength()));
+                    break;
+                }
+            }
+        }
+    } else {
+        QBENCHMARK_ALLOCATIONS(allocations) {
+            handler.route(&socket, path);
+        }
+    }
+}
+
+QTEST_MAIN(BenchQHttpHandler)
+#include "BenchQHttpHandler.moc"
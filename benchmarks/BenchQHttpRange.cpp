@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QObject>
+#include <QString>
+#include <QTest>
+
+#include <QHttpEngine/QHttpRange>
+
+#include "qallocationcounter.h"
+
+// Size of the file from which the ranges are requested
+const qint64 DataSize = 10000;
+
+class BenchQHttpRange : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase_data();
+
+    void benchParse_data();
+    void benchParse();
+
+    void benchContentRange();
+};
+
+void BenchQHttpRange::initTestCase_data()
+{
+    QBENCHMARK_ALLOCATIONS_DATA();
+}
+
+void BenchQHttpRange::benchParse_data()
+{
+    QTest::addColumn<QString>("range");
+
+    QTest::newRow("normal") << QString("0-499");
+    QTest::newRow("suffix") << QString("-500");
+    QTest::newRow("open-ended") << QString("9500-");
+    QTest::newRow("invalid") << QString("500-abc");
+}
+
+void BenchQHttpRange::benchParse()
+{
+    QFETCH_GLOBAL(bool, allocations);
+    QFETCH(QString, range);
+
+    volatile bool valid;
+    QBENCHMARK_ALLOCATIONS(allocations) {
+        valid = QHttpRange(range, DataSize).isValid();
+    }
+    Q_UNUSED(valid);
+}
+
+void BenchQHttpRange::benchContentRange()
+{
+    QFETCH_GLOBAL(bool, allocations);
+
+    // This is the value QFilesystemHandler writes in the Content-Range header
+    QHttpRange range("0-499", DataSize);
+
+    QBENCHMARK_ALLOCATIONS(allocations) {
+        QByteArray contentRange = QByteArray("bytes ") + range.contentRange().toLatin1();
+        Q_UNUSED(contentRange);
+    }
+}
+
+QTEST_MAIN(BenchQHttpRange)
+#include "BenchQHttpRange.moc"
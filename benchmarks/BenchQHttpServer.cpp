@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QSignalSpy>
+#include <QTcpSocket>
+#include <QTest>
+
+#include <QHttpEngine/QHttpHandler>
+#include <QHttpEngine/QHttpServer>
+#include <QHttpEngine/QHttpSocket>
+
+#include "common/qsimplehttpclient.h"
+
+#if defined(Q_OS_LINUX)
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/resource.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+// Number of idle connections opened, which can be overridden with the
+// QHTTPENGINE_IDLE_CONNECTIONS environment variable
+const int DefaultConnectionCount = 100000;
+
+// Memory budget for each idle connection in bytes - this should only ever be
+// lowered as the footprint of a connection is reduced
+const qint64 MaxBytesPerConnection = 8 * 1024;
+
+// Each loopback source address is used for at most this many connections so
+// that the ephemeral ports are not exhausted
+const int ConnectionsPerAddress = 20000;
+
+const QByteArray Data = "test";
+
+class DataHandler : public QHttpHandler
+{
+    Q_OBJECT
+
+protected:
+
+    virtual void process(QHttpSocket *socket, const QString &) {
+        socket->setHeader("Content-Length", QByteArray::number(Data.length()));
+        socket->write(Data);
+        socket->close();
+    }
+};
+
+class BenchQHttpServer : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void benchRequest();
+    void benchIdleConnections();
+};
+
+#if defined(Q_OS_LINUX)
+
+// Retrieve the resident set size of the process in bytes
+static qint64 residentSetSize()
+{
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+#endif
+
+void BenchQHttpServer::benchRequest()
+{
+    DataHandler handler;
+    QHttpServer server(&handler);
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    // Each iteration covers a complete request from connecting to the
+    // server until the connection is closed after the response
+    QBENCHMARK {
+        QTcpSocket socket;
+        QSimpleHttpClient client(&socket);
+        QSignalSpy disconnectedSpy(&socket, SIGNAL(disconnected()));
+
+        socket.connectToHost(server.serverAddress(), server.serverPort());
+        client.sendHeaders("GET", "/");
+
+        QVERIFY(disconnectedSpy.count() || disconnectedSpy.wait());
+        QCOMPARE(client.data(), Data);
+    }
+}
+
+void BenchQHttpServer::benchIdleConnections()
+{
+#if defined(Q_OS_LINUX)
+    int count = DefaultConnectionCount;
+    if (qEnvironmentVariableIsSet("QHTTPENGINE_IDLE_CONNECTIONS")) {
+        count = qgetenv("QHTTPENGINE_IDLE_CONNECTIONS").toInt();
+    }
+
+    // Each connection needs a descriptor for both ends
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (static_cast<qint64>(limit.rlim_cur) < count * 2 + 64) {
+        QSKIP("the limit on open files is too low for the number of connections");
+    }
+
+    // Idle connections must not be closed while the rest are opened
+    QHttpServer server;
+    server.setTimeout(QHttpSocket::HeaderTimeout, -1);
+    server.setSocketOption(QHttpServer::ListenBacklog, 4096);
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    sockaddr_in serverAddress = {};
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_port = htons(server.serverPort());
+    serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    QTest::qWait(100);
+    qint64 before = residentSetSize();
+
+    // The client ends are plain descriptors so that they do not add to the
+    // memory used by the process
+    QList<int> descriptors;
+    for (int i = 0; i < count; ++i) {
+        int descriptor = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        QVERIFY(descriptor != -1);
+        descriptors.append(descriptor);
+
+        sockaddr_in clientAddress = {};
+        clientAddress.sin_family = AF_INET;
+        clientAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 1 + i / ConnectionsPerAddress);
+        QVERIFY(::bind(descriptor, reinterpret_cast<sockaddr*>(&clientAddress), sizeof(clientAddress)) == 0);
+        ::connect(descriptor, reinterpret_cast<sockaddr*>(&serverAddress), sizeof(serverAddress));
+
+        // Let the server accept each batch before opening more
+        if ((i + 1) % 1000 == 0 || i + 1 == count) {
+            QTRY_COMPARE_WITH_TIMEOUT(server.activeConnections(), i + 1, 30000);
+        }
+    }
+
+    QTest::qWait(100);
+    qint64 perConnection = (residentSetSize() - before) / count;
+
+    foreach (int descriptor, descriptors) {
+        ::close(descriptor);
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(server.activeConnections(), 0, 30000);
+
+    QTest::setBenchmarkResult(perConnection, QTest::BytesAllocated);
+    QVERIFY2(perConnection <= MaxBytesPerConnection,
+             qPrintable(QString("%1 bytes per connection exceeds the budget").arg(perConnection)));
+#else
+    QSKIP("resident set size is only measured on Linux");
+#endif
+}
+
+QTEST_MAIN(BenchQHttpServer)
+#include "BenchQHttpServer.moc"
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTest>
+
+#include <QHttpEngine/QHttpSocket>
+
+#include "qallocationcounter.h"
+
+// Headers set by a typical handler, with cookies at the end
+const int HeaderCount = 8;
+const char *const Headers[HeaderCount][2] = {
+    {"Content-Type", "text/html; charset=utf-8"},
+    {"Content-Length", "5230"},
+    {"Cache-Control", "public, max-age=3600"},
+    {"ETag", "\"5a3c-53f0e1b2c4d80\""},
+    {"Last-Modified", "Wed, 19 Oct 2016 10:00:00 GMT"},
+    {"Set-Cookie", "session=4f1c2a9b8e7d6c5b4a39281706f5e4d3; Path=/; HttpOnly"},
+    {"Set-Cookie", "theme=dark; Path=/; Max-Age=31536000"},
+    {"Set-Cookie", "lang=en; Path=/"}
+};
+
+class BenchQHttpSocket : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase_data();
+
+    void benchWriteHeaders_data();
+    void benchWriteHeaders();
+};
+
+void BenchQHttpSocket::initTestCase_data()
+{
+    QBENCHMARK_ALLOCATIONS_DATA();
+}
+
+void BenchQHttpSocket::benchWriteHeaders_data()
+{
+    QTest::addColumn<int>("count");
+
+    // Headers can only be written once for each socket, so each iteration
+    // creates one - the first row measures that alone
+    QTest::newRow("construction only") << -1;
+    QTest::newRow("no headers") << 0;
+    QTest::newRow("typical") << 5;
+    QTest::newRow("with cookies") << HeaderCount;
+}
+
+void BenchQHttpSocket::benchWriteHeaders()
+{
+    QFETCH_GLOBAL(bool, allocations);
+    QFETCH(int, count);
+
+    // The socket is not connected, so the headers remain in the output
+    // buffer and nothing is sent
+    QBENCHMARK_ALLOCATIONS(allocations) {
+        QHttpSocket socket(new QTcpSocket);
+        if (count >= 0) {
+            for (int i = 0; i < count; ++i) {
+                socket.setHeader(Headers[i][0], Headers[i][1], false);
+            }
+            socket.writeHeaders();
+        }
+    }
+}
+
+QTEST_MAIN(BenchQHttpSocket)
+#include "BenchQHttpSocket.moc"
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QObject>
+#include <QTest>
+
+#include <QHttpEngine/QHttpSocket>
+#include <QHttpEngine/QIByteArray>
+
+#include "qallocationcounter.h"
+
+Q_DECLARE_METATYPE(QIByteArray)
+
+class BenchQIByteArray : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase_data();
+
+    void benchCompare_data();
+    void benchCompare();
+
+    void benchLookup_data();
+    void benchLookup();
+};
+
+void BenchQIByteArray::initTestCase_data()
+{
+    QBENCHMARK_ALLOCATIONS_DATA();
+}
+
+void BenchQIByteArray::benchCompare_data()
+{
+    QTest::addColumn<QIByteArray>("a");
+    QTest::addColumn<QIByteArray>("b");
+
+    QTest::newRow("equal") << QIByteArray("Content-Type") << QIByteArray("Content-Type");
+    QTest::newRow("equal ignoring case") << QIByteArray("Content-Type") << QIByteArray("content-type");
+    QTest::newRow("different") << QIByteArray("Content-Type") << QIByteArray("Content-Tzpe");
+    QTest::newRow("different length") << QIByteArray("Content-Type") << QIByteArray("Content-Length");
+}
+
+void BenchQIByteArray::benchCompare()
+{
+    QFETCH_GLOBAL(bool, allocations);
+    QFETCH(QIByteArray, a);
+    QFETCH(QIByteArray, b);
+
+    volatile bool result;
+    QBENCHMARK_ALLOCATIONS(allocations) {
+        result = a == b;
+    }
+    Q_UNUSED(result);
+}
+
+void BenchQIByteArray::benchLookup_data()
+{
+    QTest::addColumn<QIByteArray>("name");
+
+    QTest::newRow("present") << QIByteArray("user-agent");
+    QTest::newRow("missing") << QIByteArray("x-forwarded-for");
+}
+
+void BenchQIByteArray::benchLookup()
+{
+    QFETCH_GLOBAL(bool, allocations);
+    QFETCH(QIByteArray, name);
+
+    // Headers sent by a typical browser
+    QHttpSocket::HeaderMap headers;
+    headers.insert("Host", "www.example.com");
+    headers.insert("Connection", "keep-alive");
+    headers.insert("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
+    headers.insert("Accept", "text/html,application/xhtml+xml");
+    headers.insert("Referer", "https://www.example.com/");
+    headers.insert("Accept-Encoding", "gzip, deflate, br");
+    headers.insert("Accept-Language", "en-US,en;q=0.8");
+    headers.insert("Cookie", "session=4f1c2a9b8e7d6c5b4a39281706f5e4d3");
+    headers.insert("If-None-Match", "\"5a3c-53f0e1b2c4d80\"");
+    headers.insert("Upgrade-Insecure-Requests", "1");
+
+    QBENCHMARK_ALLOCATIONS(allocations) {
+        QByteArray value = headers.value(name);
+        Q_UNUSED(value);
+    }
+}
+
+QTEST_MAIN(BenchQIByteArray)
+#include "BenchQIByteArray.moc"
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdlib>
+
+#include <QAtomicInteger>
+
+#include "qallocationcounter.h"
+
+// Number of iterations over which allocations are averaged
+const int AllocationIterations = 1000;
+
+static QBasicAtomicInteger<qint64> allocationCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+#if defined(__GLIBC__)
+
+// Replacing these functions in the executable replaces them for the whole
+// process, including the Qt libraries - memory is still released by the
+// original free()
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) __THROW
+{
+    allocationCount.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) __THROW
+{
+    allocationCount.fetchAndAddRelaxed(1);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) __THROW
+{
+    allocationCount.fetchAndAddRelaxed(1);
+    return __libc_realloc(ptr, size);
+}
+
+}
+
+#endif
+
+bool QAllocationCounter::isSupported()
+{
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+qint64 QAllocationCounter::count()
+{
+    return allocationCount.load();
+}
+
+QAllocationBenchmark::QAllocationBenchmark(bool allocations)
+    : controller(allocations ? 0 : new QTest::QBenchmarkIterationController),
+      iteration(0),
+      start(0)
+{
+}
+
+QAllocationBenchmark::~QAllocationBenchmark()
+{
+    delete controller;
+}
+
+bool QAllocationBenchmark::isDone()
+{
+    if (controller) {
+        return controller->isDone();
+    }
+
+    // The first iteration is not counted
+    if (iteration == 1) {
+        start = QAllocationCounter::count();
+    } else if (iteration == AllocationIterations + 1) {
+        QTest::setBenchmarkResult(static_cast<qreal>(QAllocationCounter::count() - start) / AllocationIterations,
+                                  QTest::Events);
+        return true;
+    }
+    return false;
+}
+
+void QAllocationBenchmark::next()
+{
+    if (controller) {
+        controller->next();
+    } else {
+        ++iteration;
+    }
+}
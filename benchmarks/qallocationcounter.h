@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QHTTPENGINE_QALLOCATIONCOUNTER_H
+#define QHTTPENGINE_QALLOCATIONCOUNTER_H
+
+#include <QTest>
+
+/**
+ * @brief Count the heap allocations made by the process
+ *
+ * Allocations can only be counted when the C library allows malloc() to be
+ * replaced (currently glibc), in which case isSupported() returns true.
+ */
+class QAllocationCounter
+{
+public:
+
+    static bool isSupported();
+
+    /**
+     * @brief Retrieve the number of allocations made so far
+     */
+    static qint64 count();
+};
+
+/**
+ * @brief Controller for QBENCHMARK_ALLOCATIONS()
+ *
+ * When counting allocations, the code runs once to warm up any caches and
+ * then a fixed number of times, reporting the average number of allocations
+ * as events per iteration. Otherwise, it is timed by QBENCHMARK.
+ */
+class QAllocationBenchmark
+{
+public:
+
+    explicit QAllocationBenchmark(bool allocations);
+    ~QAllocationBenchmark();
+
+    bool isDone();
+    void next();
+
+private:
+
+    QTest::QBenchmarkIterationController *controller;
+    int iteration;
+    qint64 start;
+};
+
+// Measure the time taken by the code that follows or, if allocations is
+// true, the number of allocations it makes
+#define QBENCHMARK_ALLOCATIONS(allocations) \
+    for (QAllocationBenchmark _benchmark(allocations); !_benchmark.isDone(); _benchmark.next())
+
+// Global data shared by all benchmarks in a class, which run each of them
+// once for each metric
+#define QBENCHMARK_ALLOCATIONS_DATA() \
+    QTest::addColumn<bool>("allocations"); \
+    QTest::newRow("time") << false; \
+    if (QAllocationCounter::isSupported()) { \
+        QTest::newRow("allocations") << true; \
+    }
+
+#endif // QHTTPENGINE_QALLOCATIONCOUNTER_H
@@ -24,7 +24,7 @@
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QHostAddress>
-#include <QRegExp>
+#include <QRegularExpression>
 #include <QStringList>
 
 #include <QHttpEngine/QFilesystemHandler>
@@ -64,10 +64,10 @@ int main(int argc, char * argv[])
 
     // Build the hierarchy of handlers
     QFilesystemHandler handler(":/static");
-    handler.addRedirect(QRegExp("^$"), "/index.html");
+    handler.addRedirect(QRegularExpression("^$"), "/index.html");
 
     ApiHandler apiHandler;
-    handler.addSubHandler(QRegExp("api/"), &apiHandler);
+    handler.addSubHandler(QRegularExpression("^api/"), &apiHandler);
 
     QHttpServer server(&handler);
 
@@ -45,6 +45,23 @@ class QHTTPENGINE_EXPORT QFilesystemHandlerPrivate;
  * Requests for resources outside the root will be ignored. The document root
  * can be modified after initialization. It is possible to use a resource
  * directory for the document root.
+ *
+ * Requests for a directory produce a listing of its contents. The directory
+ * is read and the listing streamed to the client as the connection can
+ * accept it, so that the listing of a very large directory does not need to
+ * be held in memory. Listings of up to 4096 entries are sorted by name
+ * without regard to case, while larger ones are in the order the
+ * filesystem returns them. Clients that include
+ * `application/json` in the `Accept` header receive a JSON array of entries
+ * instead of an HTML page:
+ *
+ * @code
+ * [{"name":"index.html","type":"file"},{"name":"images","type":"dir"}]
+ * @endcode
+ *
+ * Rendered listings are cached and reused for as long as the modification
+ * time of the directory is unchanged. The size of the cache can be adjusted
+ * with setListingCacheSize().
  */
 class QHTTPENGINE_EXPORT QFilesystemHandler : public QHttpHandler
 {
@@ -70,6 +87,15 @@ public:
      */
     void setDocumentRoot(const QString &documentRoot);
 
+    /**
+     * @brief Set the maximum size of the directory listing cache
+     *
+     * The size is the total number of bytes of rendered listings that will
+     * be kept. Listings larger than the cache are always streamed. Setting
+     * the size to zero disables the cache.
+     */
+    void setListingCacheSize(int size);
+
 protected:
 
     /**
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QHTTPENGINE_QHTTPACCESSLOG_H
+#define QHTTPENGINE_QHTTPACCESSLOG_H
+
+#include <QHttpEngine/QHttpMiddleware>
+
+#include "qhttpengine_global.h"
+
+class QHTTPENGINE_EXPORT QHttpAccessLogPrivate;
+
+/**
+ * @brief Middleware that writes an access log
+ *
+ * A line is written for each request once the response has been sent. The
+ * lines are collected in memory and written to the file in batches by a
+ * background thread, so request processing never waits for the disk:
+ *
+ * @code
+ * QHttpAccessLog accessLog("/var/log/app/access.log");
+ * accessLog.setFormat(QHttpAccessLog::CombinedFormat);
+ *
+ * QHttpHandler handler;
+ * handler.addMiddleware(&accessLog);
+ * @endcode
+ *
+ * If the writer falls behind and the amount of data waiting to be written
+ * exceeds setMaxPendingSize(), new lines are discarded and counted instead.
+ * The number of discarded lines can be retrieved with droppedLines().
+ *
+ * The file can be rotated once it reaches a maximum size, in which case it
+ * is renamed with a ".1" suffix and any older files are renamed in turn.
+ */
+class QHTTPENGINE_EXPORT QHttpAccessLog : public QHttpMiddleware
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief Format of each line
+     */
+    enum Format {
+        /// Common Log Format
+        CommonFormat,
+        /// Combined Log Format (includes the referer and user agent)
+        CombinedFormat,
+        /// JSON object on each line
+        JsonFormat
+    };
+
+    /**
+     * @brief Create access logging middleware writing to the specified file
+     *
+     * The file is opened for appending by the writer thread.
+     */
+    explicit QHttpAccessLog(const QString &fileName, QObject *parent = Q_NULLPTR);
+
+    /**
+     * @brief Destroy the middleware
+     *
+     * Lines that were not yet written are written before this returns.
+     */
+    virtual ~QHttpAccessLog();
+
+    /**
+     * @brief Set the format of each line
+     *
+     * The default is CommonFormat. The request line does not include the
+     * protocol version and the size is the number of bytes of the response
+     * body sent, excluding the headers. JSON lines also include the duration
+     * of the request in microseconds.
+     */
+    void setFormat(Format format);
+
+    /**
+     * @brief Log only one in every interval requests
+     *
+     * The default is 1, which logs every request.
+     */
+    void setSampleInterval(int interval);
+
+    /**
+     * @brief Set the maximum size of the file before it is rotated
+     *
+     * A size of zero (the default) disables rotation.
+     */
+    void setMaxFileSize(qint64 size);
+
+    /**
+     * @brief Set the number of rotated files that are kept
+     *
+     * The default is 5.
+     */
+    void setMaxFiles(int count);
+
+    /**
+     * @brief Set the amount of data that may wait for the writer
+     *
+     * Lines are discarded while this is exceeded. The default is 4 MB.
+     */
+    void setMaxPendingSize(qint64 size);
+
+    /**
+     * @brief Set the interval (in milliseconds) at which lines are written
+     *
+     * Lines are also handed to the writer as soon as enough of them are
+     * collected. The default is 1000.
+     */
+    void setFlushInterval(int msec);
+
+    /**
+     * @brief Retrieve the number of lines that were discarded
+     */
+    qint64 droppedLines() const;
+
+    /**
+     * @brief Write all collected lines to the file
+     *
+     * This blocks until the writer has written everything.
+     */
+    void flush();
+
+    /**
+     * @brief Process the request
+     */
+    virtual bool process(QHttpSocket *socket);
+
+private:
+
+    QHttpAccessLogPrivate *const d;
+    friend class QHttpAccessLogPrivate;
+};
+
+#endif // QHTTPENGINE_QHTTPACCESSLOG_H
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef QHTTPENGINE_QHTTPASYNCMIDDLEWARE_H
+#define QHTTPENGINE_QHTTPASYNCMIDDLEWARE_H
+
+#include <QHttpEngine/QHttpMiddleware>
+
+#include "qhttpengine_global.h"
+
+class QHTTPENGINE_EXPORT QHttpAsyncMiddlewarePrivate;
+
+/**
+ * @brief Middleware that decides asynchronously
+ *
+ * Some checks, such as looking up a token with another service, cannot be
+ * completed without waiting for I/O. Rather than blocking the event loop,
+ * derived classes override start() to begin the check and invoke finish()
+ * once a decision has been made. When used with a QHttpHandler, routing
+ * resumes with the next middleware as soon as finish() is invoked with
+ * true. If the request is denied, an appropriate error should be written
+ * to the socket before finish() is invoked.
+ *
+ * If no decision is made before the timeout expires, 504 Gateway Timeout
+ * is written to the socket. The cancel() method is invoked when a pending
+ * decision is abandoned because of a timeout or because the client
+ * disconnected, allowing the check to be aborted. Invoking finish() for an
+ * abandoned decision has no effect.
+ */
+class QHTTPENGINE_EXPORT QHttpAsyncMiddleware : public QHttpMiddleware
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief Base constructor for asynchronous middleware
+     */
+    explicit QHttpAsyncMiddleware(QObject *parent = Q_NULLPTR);
+
+    /**
+     * @brief Set the time allowed for a decision in milliseconds
+     *
+     * The default is 30 seconds. A negative value disables the timeout.
+     */
+    void setTimeout(int msecs);
+
+    /**
+     * @brief Begin processing the request
+     *
+     * This method always returns false since the decision is not known
+     * until later. Routing is only resumed when the middleware is used with
+     * a QHttpHandler.
+     */
+    virtual bool process(QHttpSocket *socket);
+
+protected:
+
+    /**
+     * @brief Begin determining if request processing should continue
+     */
+    virtual void start(QHttpSocket *socket) = 0;
+
+    /**
+     * @brief Abort determining if request processing should continue
+     *
+     * If the client disconnected, the socket may be in the process of being
+     * destroyed and should only be used to identify the request. The
+     * default implementation does nothing.
+     */
+    virtual void cancel(QHttpSocket *socket);
+
+    /**
+     * @brief Indicate whether request processing should continue
+     */
+    void finish(QHttpSocket *socket, bool proceed);
+
+private:
+
+    QHttpAsyncMiddlewarePrivate *const d;
+    friend class QHttpAsyncMiddlewarePrivate;
+};
+
+#endif // QHTTPENGINE_QHTTPASYNCMIDDLEWARE_H
@@ -33,10 +33,22 @@ class QHTTPENGINE_EXPORT QHttpBasicAuthPrivate;
  * @brief Middleware for HTTP basic authentication
  *
  * HTTP Basic authentication allows access to specific resources to be
- * restricted. This class uses a map to store accepted username/password
- * combinations, which are then used for authenticating requests. To use a
- * different method of authentication, override the verify() method in a
- * derived class.
+ * restricted. This class stores a salted PBKDF2 hash of the password for
+ * each accepted username, which is then used for authenticating requests.
+ * Hashes can be generated ahead of time with hashPassword() so that the
+ * passwords themselves never need to be available to the server:
+ *
+ * @code
+ * QHttpBasicAuth auth("Example");
+ * auth.addHash("username", "pbkdf2-sha256$10000$...$...");
+ * @endcode
+ *
+ * Since deriving the hash is deliberately expensive, credentials that were
+ * successfully verified are remembered (as a keyed digest) so that the hash
+ * is only derived the first time a client presents them. To use a different
+ * method of authentication, override the verify() method in a derived class.
+ * It is invoked for every request, so credentials it stops accepting are
+ * rejected immediately.
  */
 class QHTTPENGINE_EXPORT QHttpBasicAuth : public QHttpMiddleware
 {
@@ -59,6 +71,30 @@ public:
      */
     void add(const QString &username, const QString &password);
 
+    /**
+     * @brief Add credentials to the list using a hash of the password
+     *
+     * The hash must be in the format produced by hashPassword(). False is
+     * returned if the hash cannot be parsed.
+     */
+    bool addHash(const QString &username, const QByteArray &hash);
+
+    /**
+     * @brief Set the number of verified credentials that are remembered
+     *
+     * A size of zero disables the cache. The default is 1024.
+     */
+    void setCacheSize(int size);
+
+    /**
+     * @brief Generate a salted hash of the password
+     *
+     * The hash uses PBKDF2 with HMAC-SHA256 and has the format
+     * "pbkdf2-sha256$iterations$salt$hash", where the salt and hash are
+     * base64-encoded.
+     */
+    static QByteArray hashPassword(const QString &password, int iterations = 10000);
+
     /**
      * @brief Process the request
      *
@@ -26,10 +26,11 @@
 #include <QObject>
 
 #include "qhttpengine_global.h"
+#include "qhttpsocket.h"
 
 class QRegExp;
+class QRegularExpression;
 class QHttpMiddleware;
-class QHttpSocket;
 class QHTTPENGINE_EXPORT QHttpHandlerPrivate;
 
 /**
@@ -44,26 +45,37 @@ class QHTTPENGINE_EXPORT QHttpHandlerPrivate;
  * invoking process() when one of the patterns match.
  *
  * To add a redirect, use the addRedirect() method. The first parameter is a
- * QRegExp pattern that the request path will be tested against. If it
- * matches, an HTTP 302 redirect will be written to the socket and the request
- * closed. For example, to have the root path "/" redirect to "/index.html":
+ * QRegularExpression pattern that the request path will be tested against.
+ * If it matches, an HTTP 302 redirect will be written to the socket and the
+ * request closed. For example, to have the root path "/" redirect to
+ * "/index.html":
  *
  * @code
  * QHttpHandler handler;
- * handler.addRedirect(QRegExp("^$"), "/index.html");
+ * handler.addRedirect(QRegularExpression("^$"), "/index.html");
  * @endcode
  *
  * To add a sub-handler, use the addSubHandler() method. Again, the first
- * parameter is a QRegExp pattern. If the pattern matches, the portion of the
- * path that matched the pattern is removed from the path and it is passed to
- * the sub-handler's route() method. For example, to have a sub-handler
- * invoked when the path begins with "/api/":
+ * parameter is a QRegularExpression pattern. If the pattern matches, the
+ * portion of the path up to the end of the match is removed from the path
+ * and it is passed to the sub-handler's route() method. For example, to have
+ * a sub-handler invoked when the path begins with "/api/":
  *
  * @code
  * QHttpHandler handler, subHandler;
- * handler.addSubHandler(QRegExp("^api/"), &subHandler);
+ * handler.addSubHandler(QRegularExpression("^api/"), &subHandler);
  * @endcode
  *
+ * Patterns are optimized when they are added, so the cost of compiling them
+ * is not paid by the first request. Overloads that accept QRegExp are also
+ * provided for compatibility but are deprecated.
+ *
+ * Patterns that begin with "^" and otherwise contain only literal characters
+ * (optionally followed by "$") are matched by prefix in a single lookup that
+ * does not depend on the number of patterns. Other patterns are tested in
+ * order as regular expressions. In both cases, the first pattern added that
+ * matches the path is used.
+ *
  * If the request doesn't match any redirect or sub-handler patterns, it is
  * passed along to the process() method, which is expected to either process
  * the request or write an error to the socket. The default implementation of
@@ -85,6 +97,13 @@ public:
      */
     void addMiddleware(QHttpMiddleware *middleware);
 
+    /**
+     * @brief Add a redirect for a specific pattern
+     *
+     * @deprecated Use the overload that accepts a QRegularExpression
+     */
+    void addRedirect(const QRegExp &pattern, const QString &path);
+
     /**
      * @brief Add a redirect for a specific pattern
      *
@@ -95,7 +114,14 @@ public:
      * The destination path may use "%1", "%2", etc. to refer to captured
      * parts of the pattern. The client will receive an HTTP 302 redirect.
      */
-    void addRedirect(const QRegExp &pattern, const QString &path);
+    void addRedirect(const QRegularExpression &pattern, const QString &path);
+
+    /**
+     * @brief Add a handler for a specific pattern
+     *
+     * @deprecated Use the overload that accepts a QRegularExpression
+     */
+    void addSubHandler(const QRegExp &pattern, QHttpHandler *handler);
 
     /**
      * @brief Add a handler for a specific pattern
@@ -104,7 +130,44 @@ public:
      * used when the route() method is invoked to determine whether the
      * request matches any patterns. The order of the list is preserved.
      */
-    void addSubHandler(const QRegExp &pattern, QHttpHandler *handler);
+    void addSubHandler(const QRegularExpression &pattern, QHttpHandler *handler);
+
+    /**
+     * @brief Set a limit on the size of requests routed to this handler
+     *
+     * The limit is checked when route() is invoked, before middleware is
+     * run. This allows a handler to be stricter than the server - for
+     * example, limiting the size of request bodies for an API. Refer to
+     * QHttpSocket::setLimit() for details. By default, there are no limits.
+     */
+    void setLimit(QHttpSocket::Limit limit, qint64 value);
+
+    /**
+     * @brief Enable admission control for requests routed to this handler
+     *
+     * The delay of each request is the time since its headers were received
+     * plus the current event loop lag. If the delay stays above the target
+     * (in milliseconds) for an entire interval, the handler is considered
+     * overloaded. Until a delay below the target is measured again, requests
+     * that were delayed for longer than the target receive a 503 error with
+     * a Retry-After header unless they match a critical route.
+     *
+     * A negative target disables admission control (the default).
+     */
+    void setAdmissionControl(int target, int interval = 100);
+
+    /**
+     * @brief Add a route that is never shed by admission control
+     *
+     * This is useful for health checks and other requests that must be
+     * answered even when the handler is overloaded.
+     */
+    void addCriticalRoute(const QRegularExpression &pattern);
+
+    /**
+     * @brief Retrieve the number of requests shed by admission control
+     */
+    qint64 shedCount() const;
 
     /**
      * @brief Route an incoming request
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QHTTPENGINE_QHTTPMETRICSHANDLER_H
+#define QHTTPENGINE_QHTTPMETRICSHANDLER_H
+
+#include "qhttpengine_global.h"
+#include "qhttphandler.h"
+
+/**
+ * @brief Handler that exposes server metrics to Prometheus
+ * @headerfile qhttpmetricshandler.h QHttpEngine/QHttpMetricsHandler
+ *
+ * QHttpEngine records metrics for all servers and sockets in the process:
+ * the number of connections accepted, shed and active, the bytes received
+ * and sent, the responses sent by method and status code and a histogram of
+ * request latency for each handler. Handlers are identified by their
+ * objectName() or, if that is empty, their class name. Each thread records
+ * to its own counters, so recording a request costs only a few relaxed
+ * atomic increments on counters the thread usually has to itself.
+ *
+ * This handler responds to every request with the current values in the
+ * Prometheus text format, summed over all threads. It is typically added as
+ * a sub-handler:
+ *
+ * @code
+ * QHttpMetricsHandler metricsHandler;
+ * handler.addSubHandler(QRegularExpression("^metrics$"), &metricsHandler);
+ * @endcode
+ */
+class QHTTPENGINE_EXPORT QHttpMetricsHandler : public QHttpHandler
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief Create a new metrics handler
+     */
+    explicit QHttpMetricsHandler(QObject *parent = 0) : QHttpHandler(parent) {}
+
+    /**
+     * @brief Retrieve the current metrics in the Prometheus text format
+     */
+    static QByteArray exposition();
+
+protected:
+
+    /**
+     * @brief Reimplementation of QHttpHandler::process()
+     */
+    virtual void process(QHttpSocket *socket, const QString &path);
+};
+
+#endif // QHTTPENGINE_QHTTPMETRICSHANDLER_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef QHTTPENGINE_QHTTPRATELIMIT_H
+#define QHTTPENGINE_QHTTPRATELIMIT_H
+
+#include <QHttpEngine/QHttpMiddleware>
+
+#include "qhttpengine_global.h"
+
+class QHTTPENGINE_EXPORT QHttpRateLimitPrivate;
+
+/**
+ * @brief Middleware for limiting the rate of requests
+ *
+ * Each client is given a bucket of tokens that is refilled at a constant
+ * rate up to a maximum (the burst size). Each request consumes a token and
+ * its size in bytes from the buckets of the client. If there are not enough
+ * tokens, the request is rejected with 429 Too Many Requests and a
+ * Retry-After header indicating when it may succeed.
+ *
+ * Clients can be identified by their address and by an API key supplied in
+ * a request header. Limits for both are applied if enabled:
+ *
+ * @code
+ * QHttpRateLimit rateLimit;
+ * rateLimit.setRequestRate(QHttpRateLimit::ClientAddress, 10, 20);
+ * rateLimit.setRequestRate(QHttpRateLimit::ApiKey, 100, 100);
+ *
+ * QHttpHandler handler;
+ * handler.addMiddleware(&rateLimit);
+ * @endcode
+ *
+ * Buckets are stored in a fixed-size table for each type of client and are
+ * only refilled when a request arrives. Once the table is full, the bucket
+ * that was used least recently among those nearby is reused, so memory use
+ * is bounded regardless of the number of clients.
+ */
+class QHTTPENGINE_EXPORT QHttpRateLimit : public QHttpMiddleware
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief Method used to identify a client
+     */
+    enum Key {
+        /// Address of the remote peer
+        ClientAddress,
+        /// Value of the API key header (requests without one are not limited)
+        ApiKey
+    };
+
+    /**
+     * @brief Create rate limiting middleware
+     */
+    explicit QHttpRateLimit(QObject *parent = Q_NULLPTR);
+
+    /**
+     * @brief Set the number of requests per second
+     *
+     * A rate of zero (the default) disables the limit.
+     */
+    void setRequestRate(Key key, double requestsPerSecond, int burst);
+
+    /**
+     * @brief Set the number of request bytes per second
+     *
+     * The size of a request includes its headers and body. A rate of zero
+     * (the default) disables the limit.
+     */
+    void setByteRate(Key key, qint64 bytesPerSecond, qint64 burst);
+
+    /**
+     * @brief Set the name of the header containing the API key
+     *
+     * The default is "X-API-Key".
+     */
+    void setApiKeyHeader(const QByteArray &name);
+
+    /**
+     * @brief Set the number of clients tracked for each key
+     *
+     * The capacity is rounded up to a power of two. The default is 65536.
+     */
+    void setCapacity(int capacity);
+
+    /**
+     * @brief Retrieve the number of requests that were rejected
+     */
+    qint64 limitedCount() const;
+
+    /**
+     * @brief Process the request
+     */
+    virtual bool process(QHttpSocket *socket);
+
+private:
+
+    QHttpRateLimitPrivate *const d;
+    friend class QHttpRateLimitPrivate;
+};
+
+#endif // QHTTPENGINE_QHTTPRATELIMIT_H
@@ -28,6 +28,7 @@
 #include <QTcpServer>
 
 #include "qhttpengine_global.h"
+#include "qhttpsocket.h"
 
 class QHttpHandler;
 class QHTTPENGINE_EXPORT QHttpServerPrivate;
@@ -56,6 +57,17 @@ class QHTTPENGINE_EXPORT QHttpServerPrivate;
  * Before passing the socket to the handler, the QTcpSocket's disconnected()
  * signal is connected to the QHttpSocket's deleteLater() slot to ensure that
  * the socket is deleted when the client disconnects.
+ *
+ * To avoid taking on more work than can be served during overload, the
+ * number of concurrent connections can be limited. Once setMaxConnections()
+ * is reached, the server stops accepting connections (leaving them queued
+ * by the operating system) until an existing one is closed. Above the
+ * setSoftConnectionLimit(), new connections are answered immediately with a
+ * 503 error that includes a Retry-After header and are then closed.
+ *
+ * Options for the listening socket and for each accepted connection can be
+ * set with setSocketOption(). Options that are not supported by the platform
+ * are ignored.
  */
 class QHTTPENGINE_EXPORT QHttpServer : public QTcpServer
 {
@@ -63,6 +75,39 @@ class QHTTPENGINE_EXPORT QHttpServer : public QTcpServer
 
 public:
 
+    /**
+     * @brief Options applied to the listening socket and to connections
+     *
+     * Unless noted otherwise, each option applies to every accepted
+     * connection. Options for the listening socket take effect when listen()
+     * is invoked or immediately if the server is already listening.
+     */
+    enum SocketOption {
+        /// Length of the queue of pending connections (listening socket)
+        ListenBacklog = 0,
+        /// Seconds to wait for request data before accepting a connection
+        /// (listening socket, TCP_DEFER_ACCEPT)
+        DeferAccept,
+        /// Length of the queue for TCP Fast Open (listening socket)
+        FastOpen,
+        /// Nonzero to disable Nagle's algorithm (TCP_NODELAY)
+        NoDelay,
+        /// Size of the send buffer in bytes (SO_SNDBUF)
+        SendBufferSize,
+        /// Size of the receive buffer in bytes (SO_RCVBUF)
+        ReceiveBufferSize,
+        /// Amount of unsent data in bytes above which the socket is not
+        /// writable (TCP_NOTSENT_LOWAT)
+        NotSentLowWatermark,
+        /// Seconds of idle time before keepalive probes are sent - setting
+        /// this or either of the next two options enables keepalive
+        KeepAliveIdle,
+        /// Seconds between keepalive probes
+        KeepAliveInterval,
+        /// Number of unanswered probes before the connection is dropped
+        KeepAliveCount
+    };
+
     /**
      * @brief Create an HTTP server
      */
@@ -78,6 +123,115 @@ public:
      */
     void setHandler(QHttpHandler *handler);
 
+    /**
+     * @brief Listen for connections on the specified address and port
+     *
+     * This method hides QTcpServer::listen() in order to apply the options
+     * for the listening socket once it is created.
+     */
+    bool listen(const QHostAddress &address = QHostAddress::Any, quint16 port = 0);
+
+    /**
+     * @brief Set an option for the listening socket or for connections
+     *
+     * A negative value (the default for all options) leaves the option as
+     * provided by the operating system.
+     */
+    void setSocketOption(SocketOption option, int value);
+
+    /**
+     * @brief Retrieve the value set for an option
+     */
+    int socketOption(SocketOption option) const;
+
+    /**
+     * @brief Set the amount of unread request data kept in memory
+     *
+     * This value is applied to each new QHttpSocket. Refer to
+     * QHttpSocket::setBodySpillThreshold() for details.
+     */
+    void setBodySpillThreshold(qint64 size);
+
+    /**
+     * @brief Set a limit on the size of each request
+     *
+     * This value is applied to each new QHttpSocket. Refer to
+     * QHttpSocket::setLimit() for details.
+     */
+    void setLimit(QHttpSocket::Limit limit, qint64 value);
+
+    /**
+     * @brief Retrieve the number of requests rejected for exceeding a limit
+     *
+     * This includes requests rejected by limits set on handlers.
+     */
+    qint64 rejectedCount(QHttpSocket::Limit limit) const;
+
+    /**
+     * @brief Set a deadline for each connection in milliseconds
+     *
+     * This value is applied to each new QHttpSocket. Refer to
+     * QHttpSocket::setTimeout() for details. Unlike QHttpSocket, the server
+     * defaults to a header timeout of 30 seconds.
+     */
+    void setTimeout(QHttpSocket::Timeout timeout, int msecs);
+
+    /**
+     * @brief Set the minimum rate at which data must be transferred
+     *
+     * This value is applied to each new QHttpSocket. Refer to
+     * QHttpSocket::setMinimumTransferRate() for details.
+     */
+    void setMinimumTransferRate(qint64 bytesPerSecond);
+
+    /**
+     * @brief Set the maximum number of concurrent connections
+     *
+     * A negative value (the default) removes the limit.
+     */
+    void setMaxConnections(int count);
+
+    /**
+     * @brief Set the number of connections above which requests are shed
+     *
+     * A negative value (the default) removes the limit.
+     */
+    void setSoftConnectionLimit(int count);
+
+    /**
+     * @brief Set the value of the Retry-After header for shed requests
+     *
+     * The default is one second.
+     */
+    void setRetryAfter(int seconds);
+
+    /**
+     * @brief Retrieve the number of connections currently being served
+     */
+    int activeConnections() const;
+
+    /**
+     * @brief Retrieve the total number of connections accepted
+     */
+    qint64 acceptedConnections() const;
+
+    /**
+     * @brief Retrieve the total number of connections shed with a 503 error
+     */
+    qint64 rejectedConnections() const;
+
+Q_SIGNALS:
+
+    /**
+     * @brief Indicate that a request was completed
+     *
+     * This signal is emitted when QHttpSocket::requestCompleted() is emitted
+     * by any of the sockets created by the server. The time of each phase of
+     * the request can be retrieved with QHttpSocket::phaseTime(), which makes
+     * it possible to log slow requests without modifying each handler.
+     */
+    void requestCompleted(QHttpSocket *socket);
+
 private:
 
     QHttpServerPrivate *const d;
@@ -72,6 +72,12 @@ class QHTTPENGINE_EXPORT QHttpSocketPrivate;
  * client. Otherwise the readChannelFinished() signal will be emitted
  * immediately after the headers are read.
  *
+ * Request data that has been received but not yet read is kept in memory
+ * until it exceeds the threshold set with setBodySpillThreshold(). From that
+ * point on, the data is stored in a temporary file instead. This is
+ * transparent to code that reads from the socket, but the file can also be
+ * accessed directly by using the name returned by bodyFileName().
+ *
  * The status code and headers may be set as long as no data has been written
  * to the device and the writeHeaders() method has not been called. The
  * headers are written either when the writeHeaders() method is called or when
@@ -159,18 +165,81 @@ public:
         NotFound = 404,
         /// Method is not valid for the resource
         MethodNotAllowed = 405,
+        /// The client did not produce a request in time
+        RequestTimeout = 408,
         /// The request could not be completed due to a conflict with the current state of the resource
         Conflict = 409,
+        /// The request body is larger than the server is willing to process
+        PayloadTooLarge = 413,
+        /// The request URI is longer than the server is willing to interpret
+        UriTooLong = 414,
+        /// The client has sent too many requests in a given amount of time
+        TooManyRequests = 429,
+        /// The request headers are larger than the server is willing to process
+        RequestHeaderFieldsTooLarge = 431,
         /// An internal server error occurred
         InternalServerError = 500,
         /// Invalid response from server while acting as a gateway
         BadGateway = 502,
         /// Server unable to handle request due to overload
         ServiceUnavailable = 503,
+        /// A service the server depends on did not respond in time
+        GatewayTimeout = 504,
         /// Server does not supports the HTTP version in the request
         HttpVersionNotSupported = 505
     };
 
+    /**
+     * Limits on the size of a request
+     *
+     * Requests exceeding a limit are rejected with an error as soon as the
+     * violation is detected, before the rest of the request is buffered.
+     */
+    enum Limit {
+        /// Size of the request line and headers in bytes (431)
+        MaxHeaderSize,
+        /// Number of request headers (431)
+        MaxHeaderCount,
+        /// Length of the request URI in bytes (414)
+        MaxUriLength,
+        /// Size of the request body in bytes (413)
+        MaxBodySize
+    };
+
+    /**
+     * Deadlines for receiving a request and the connection as a whole
+     */
+    enum Timeout {
+        /// Time from the start of the connection until the headers are received
+        HeaderTimeout,
+        /// Time from receiving the headers until the body is received
+        BodyTimeout,
+        /// Time without data being sent or received
+        IdleTimeout,
+        /// Time from the start of the connection until the response is written
+        TotalTimeout
+    };
+
+    /**
+     * Points in the life of a request at which the time is recorded
+     */
+    enum Phase {
+        /// Socket was created for the connection
+        AcceptedPhase,
+        /// First byte of the request was received
+        FirstByteReceivedPhase,
+        /// Request headers were parsed
+        HeadersParsedPhase,
+        /// Handler's process() method was invoked
+        DispatchedPhase,
+        /// Handler's process() method returned
+        HandlerReturnedPhase,
+        /// First byte of the response was written to the operating system
+        FirstByteSentPhase,
+        /// Last byte of the response was written to the operating system
+        LastByteSentPhase
+    };
+
     /**
      * @brief Create a new QHttpSocket from a QTcpSocket
      *
@@ -256,6 +325,76 @@ public:
      */
     qint64 contentLength() const;
 
+    /**
+     * @brief Set a limit on the size of the request
+     *
+     * A negative value removes the limit. By default, the headers are
+     * limited to 64 KB, the number of headers to 100 and the URI to 8 KB.
+     * The size of the body is not limited.
+     */
+    void setLimit(Limit limit, qint64 value);
+
+    /**
+     * @brief Retrieve a limit on the size of the request
+     */
+    qint64 limit(Limit limit) const;
+
+    /**
+     * @brief Set a deadline for the connection in milliseconds
+     *
+     * If a deadline passes before the response has begun, a 408 error is
+     * written and the socket is closed. Otherwise, the connection is
+     * aborted. A negative value removes the deadline (the default).
+     *
+     * Deadlines for all sockets in a thread are tracked together and are
+     * checked with a granularity of roughly one eighth of a second.
+     */
+    void setTimeout(Timeout timeout, int msecs);
+
+    /**
+     * @brief Retrieve a deadline for the connection in milliseconds
+     */
+    int timeout(Timeout timeout) const;
+
+    /**
+     * @brief Set the minimum rate at which data must be transferred
+     *
+     * While the request is being received or response data is waiting to
+     * be sent, the number of bytes transferred in each direction is checked
+     * every five seconds. If fewer bytes than the rate requires were
+     * transferred, the connection times out as described for setTimeout().
+     * A value of zero disables the check (the default).
+     */
+    void setMinimumTransferRate(qint64 bytesPerSecond);
+
+    /**
+     * @brief Set the amount of unread request data kept in memory
+     *
+     * Once more than this number of bytes has been received and not read,
+     * the data is moved to a temporary file. The default is 1 MB. A negative
+     * value keeps all data in memory.
+     */
+    void setBodySpillThreshold(qint64 size);
+
+    /**
+     * @brief Retrieve the name of the file containing the request data
+     *
+     * An empty string is returned if the data is held in memory. The file
+     * contains all data received after the first byte that has not been
+     * read and is removed when the socket is destroyed.
+     */
+    QString bodyFileName() const;
+
+    /**
+     * @brief Retrieve the time at which a phase of the request was reached
+     *
+     * The time is in nanoseconds on a monotonic clock shared by all sockets
+     * in the process, so the times of different sockets can be compared. If
+     * the phase was not reached (yet), -1 is returned. The complete timeline
+     * is available once requestCompleted() is emitted.
+     */
+    qint64 phaseTime(Phase phase) const;
+
     /**
      * @brief Parse the request body as a JSON document
      *
@@ -287,8 +426,10 @@ public:
      * @brief Set a response header to a specific value
      *
      * This method may only be called before the response headers are written.
-     * Duplicate values will be either appended to the header or used to
-     * replace the original value, depending on the third parameter.
+     * Duplicate values will be either added to the header or used to replace
+     * the original value, depending on the third parameter. Added values are
+     * written as a comma-separated list, except for Set-Cookie, which is
+     * written once for each value.
      */
     void setHeader(const QByteArray &name, const QByteArray &value, bool replace = true);
 
@@ -300,11 +441,28 @@ public:
      */
     void setHeaders(const HeaderMap &headers);
 
+    /**
+     * @brief Set the size of the output buffer
+     *
+     * Response data is collected in a buffer and written to the underlying
+     * socket once the buffer reaches this size, when control returns to the
+     * event loop or when flush() is invoked. The default is 16 KB. A value of
+     * zero writes all data immediately.
+     */
+    void setOutputBufferSize(qint64 size);
+
+    /**
+     * @brief Write the contents of the output buffer to the socket
+     */
+    void flush();
+
     /**
      * @brief Write response headers to the socket
      *
      * This method should not be invoked after the response headers have been
-     * written.
+     * written. Headers with the same name are merged into a single line (with
+     * the exception of `Set-Cookie`) and the `Date` and `Server` headers are
+     * added unless they were set explicitly.
      */
     void writeHeaders();
 
@@ -318,6 +476,17 @@ public:
      */
     void writeError(int statusCode, const QByteArray &statusReason = QByteArray());
 
+    /**
+     * @brief Set the HTML template used by writeError()
+     *
+     * In the template, "%1" is replaced with the status code, "%2" with the
+     * reason phrase and "%3" with the version of QHttpEngine. The template
+     * applies to all sockets. Responses for standard errors are built from
+     * it once and reused, so that writing one does not allocate. A null
+     * string restores the default template.
+     */
+    static void setErrorTemplate(const QString &errorTemplate);
+
     /**
      * @brief Write the specified JSON document to the socket and close it
      */
@@ -335,6 +504,23 @@ Q_SIGNALS:
      */
     void headersParsed();
 
+    /**
+     * @brief Indicate that the request was rejected for exceeding a limit
+     *
+     * An error has already been written to the socket when this signal is
+     * emitted.
+     */
+    void limitExceeded(QHttpSocket::Limit limit);
+
+    /**
+     * @brief Indicate that the entire response was sent
+     *
+     * This signal is emitted once the socket was closed and all of the
+     * response was written to the operating system. The time of each phase
+     * can be retrieved with phaseTime().
+     */
+    void requestCompleted();
+
 protected:
 
     /**
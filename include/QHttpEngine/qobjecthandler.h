@@ -23,6 +23,8 @@
 #ifndef QHTTPENGINE_QOBJECTHANDLER_H
 #define QHTTPENGINE_QOBJECTHANDLER_H
 
+#include <QVariantMap>
+
 #include <QHttpEngine/QHttpHandler>
 
 #include "qhttpengine_global.h"
@@ -67,6 +69,23 @@ class QHTTPENGINE_EXPORT QObjectHandlerPrivate;
  *     // do something
  * });
  * @endcode
+ *
+ * The name of a method may also be a template containing parameters in
+ * braces. Each parameter matches a single path segment and may specify a
+ * type after a colon - "int" segments must be integers and are passed as
+ * int, all other parameters are passed as strings. Parameters are converted
+ * once while the path is matched and are passed to the slot in a
+ * QVariantMap, which may be accepted as a second argument:
+ *
+ * @code
+ * handler.registerMethod("users/{id:int}/orders", [](QHttpSocket *socket, const QVariantMap &params) {
+ *     int id = params.value("id").toInt();
+ * });
+ * @endcode
+ *
+ * Methods with exact names take precedence over templates. Matching a path
+ * against the templates requires one lookup per path segment, regardless of
+ * how many methods are registered.
  */
 class QHTTPENGINE_EXPORT QObjectHandler : public QHttpHandler
 {
@@ -82,7 +101,9 @@ public:
     /**
      * @brief Register a method
      *
-     * This overload uses the traditional connection syntax with macros.
+     * This overload uses the traditional connection syntax with macros. The
+     * slot must take a QHttpSocket* and, optionally, a QVariantMap with the
+     * parameters of the template.
      *
      * The readAll parameter determines whether all data must be received by
      * the socket before invoking the slot.
@@ -119,12 +140,12 @@ public:
 
         typedef QtPrivate::FunctionPointer<Func1> SlotType;
 
-        // Ensure the slot doesn't have too many arguments
-        Q_STATIC_ASSERT_X(int(SlotType::ArgumentCount) == 1,
-                          "The slot must have exactly one argument.");
+        // Ensure the slot has the right number of arguments
+        Q_STATIC_ASSERT_X(int(SlotType::ArgumentCount) == 1 || int(SlotType::ArgumentCount) == 2,
+                          "The slot must have one or two arguments.");
 
-        // Ensure the argument is of the correct type
-        Q_STATIC_ASSERT_X((QtPrivate::AreArgumentsCompatible<QHttpSocket*, typename QtPrivate::List_Select<typename SlotType::Arguments, 0>::Value>::value),
+        // Ensure the arguments are of the correct type
+        Q_STATIC_ASSERT_X((QtPrivate::CheckCompatibleArguments<QtPrivate::List<QHttpSocket*, const QVariantMap&>, typename SlotType::Arguments>::value),
                           "The slot parameters do not match");
 
         // Invoke the implementation
@@ -162,16 +183,16 @@ private:
 
         typedef QtPrivate::FunctionPointer<Func1Operator> SlotType;
 
-        // Ensure the slot doesn't have too many arguments
-        Q_STATIC_ASSERT_X(int(SlotType::ArgumentCount) == 1,
-                          "The slot must have exactly one argument.");
+        // Ensure the slot has the right number of arguments
+        Q_STATIC_ASSERT_X(int(SlotType::ArgumentCount) == 1 || int(SlotType::ArgumentCount) == 2,
+                          "The slot must have one or two arguments.");
 
-        // Ensure the argument is of the correct type
-        Q_STATIC_ASSERT_X((QtPrivate::AreArgumentsCompatible<QHttpSocket*, typename QtPrivate::List_Select<typename SlotType::Arguments, 0>::Value>::value),
+        // Ensure the arguments are of the correct type
+        Q_STATIC_ASSERT_X((QtPrivate::CheckCompatibleArguments<QtPrivate::List<QHttpSocket*, const QVariantMap&>, typename SlotType::Arguments>::value),
                           "The slot parameters do not match");
 
         registerMethodImpl(name, context,
-                           new QtPrivate::QFunctorSlotObject<Func1, 1, typename SlotType::Arguments, void>(slot),
+                           new QtPrivate::QFunctorSlotObject<Func1, int(SlotType::ArgumentCount), typename SlotType::Arguments, void>(slot),
                            readAll);
     }
 
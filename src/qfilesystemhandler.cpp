@@ -20,9 +20,14 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+
+#include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
-#include <QFileInfoList>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
 #include <QUrl>
 
 #include <QHttpEngine/QFilesystemHandler>
@@ -30,9 +35,11 @@
 #include <QHttpEngine/QIODeviceCopier>
 
 #include "qfilesystemhandler_p.h"
+#include "qhttpsocket_p.h"
 
-// Template for listing directory contents
-const QString ListTemplate =
+// Templates for the beginning and end of an HTML directory listing - the
+// entries are written between them as the directory is traversed
+const QString ListHeaderTemplate =
         "<!DOCTYPE html>"
         "<html>"
           "<head>"
@@ -42,14 +49,30 @@ const QString ListTemplate =
           "<body>"
             "<h1>%1</h1>"
             "<p>Directory listing:</p>"
-            "<ul>%2</ul>"
+            "<ul>";
+
+const QByteArray ListFooter =
+            "</ul>"
             "<hr>"
-            "<p><em>QHttpEngine %3</em></p>"
+            "<p><em>QHttpEngine " QHTTPENGINE_VERSION "</em></p>"
           "</body>"
         "</html>";
 
+// Number of directory entries rendered at a time
+const int ListingBatchSize = 512;
+
+// Listings with up to this many entries are sorted before being rendered
+const int ListingSortLimit = 4096;
+
+// Rendering pauses while more than this many bytes wait to be written
+const qint64 ListingHighWaterMark = 65536;
+
+// Default value for the listing cache size (in bytes)
+const int DefaultListingCacheSize = 8 * 1024 * 1024;
+
 QFilesystemHandlerPrivate::QFilesystemHandlerPrivate(QFilesystemHandler *handler)
-    : QObject(handler)
+    : QObject(handler),
+      listingCache(DefaultListingCacheSize)
 {
 }
 
@@ -123,26 +146,197 @@ void QFilesystemHandlerPrivate::processFile(QHttpSocket *socket, const QString &
 
 void QFilesystemHandlerPrivate::processDirectory(QHttpSocket *socket, const QString &path, const QString &absolutePath)
 {
-    // Add entries for each of the files
-    QString listing;
-    foreach (QFileInfo info, QDir(absolutePath).entryInfoList()) {
-        listing.append(QString("<li><a href=\"%1%2\">%1%2</a></li>")
-                .arg(info.fileName().toHtmlEscaped())
-                .arg(info.isDir() ? "/" : ""));
+    // Determine which format the client would prefer
+    bool json = socket->headers().value("Accept").contains("application/json");
+    QByteArray contentType = json ? "application/json" : "text/html";
+    QString key = json ? "json:" + absolutePath : "html:" + path;
+
+    // If the listing was cached and the directory has not changed since then,
+    // the cached copy can be written directly with a known length
+    QDateTime lastModified = QFileInfo(absolutePath).lastModified();
+    QFilesystemListing *listing = listingCache.object(key);
+    if (listing && listing->lastModified == lastModified) {
+        socket->setHeader("Content-Type", contentType);
+        socket->setHeader("Content-Length", QByteArray::number(listing->data.length()));
+        socket->write(listing->data);
+        socket->close();
+        return;
     }
 
-    // Build the response and convert the string to UTF-8
-    QByteArray data = ListTemplate
-            .arg("/" + path.toHtmlEscaped())
-            .arg(listing)
-            .arg(QHTTPENGINE_VERSION)
-            .toUtf8();
+    // Otherwise stream the listing - the length is not known in advance, so
+    // the end of the content is indicated by closing the connection
+    socket->setHeader("Content-Type", contentType);
+
+    QFilesystemListingWriter *writer = new QFilesystemListingWriter(
+        this, socket, key, path, absolutePath, json, lastModified
+    );
+    writer->start();
+}
+
+QFilesystemListingWriter::QFilesystemListingWriter(QFilesystemHandlerPrivate *handler, QHttpSocket *socket,
+                                                   const QString &key, const QString &path,
+                                                   const QString &absolutePath, bool json,
+                                                   const QDateTime &lastModified)
+    : QObject(socket),
+      handler(handler),
+      socket(socket),
+      key(key),
+      path(path),
+      absolutePath(absolutePath),
+      json(json),
+      lastModified(lastModified),
+      iterator(absolutePath, QDir::AllEntries),
+      next(0),
+      count(0),
+      waiting(false),
+      caching(false)
+{
+    // The modification time of a directory has a granularity of one second
+    // on some filesystems, so a listing rendered within a second of the last
+    // change could miss a later change in the same second and is not cached
+    caching = handler->listingCache.maxCost() > 0 &&
+            lastModified.isValid() &&
+            lastModified < QDateTime::currentDateTime().addSecs(-1);
+}
+
+void QFilesystemListingWriter::start()
+{
+    // Read ahead up to the limit - if the directory ends within it, the
+    // entries are sorted, otherwise they are listed in the order read so
+    // that neither the time before the first byte nor the memory used grows
+    // with the size of the directory
+    while (entries.count() < ListingSortLimit && iterator.hasNext()) {
+        iterator.next();
+        QFileInfo info = iterator.fileInfo();
+        entries.append(qMakePair(info.fileName(), info.isDir()));
+    }
+    if (!iterator.hasNext()) {
+        std::sort(entries.begin(), entries.end(), [](const QPair<QString, bool> &a, const QPair<QString, bool> &b) {
+            return a.first.compare(b.first, Qt::CaseInsensitive) < 0;
+        });
+    }
+
+    connect(socket, &QHttpSocket::bytesWritten, this, &QFilesystemListingWriter::onBytesWritten);
+
+    if (json) {
+        write("[");
+    } else {
+        write(ListHeaderTemplate.arg("/" + path.toHtmlEscaped()).toUtf8());
+    }
+
+    nextBatch();
+}
+
+void QFilesystemListingWriter::nextBatch()
+{
+    // If the client has gone away, there is nothing left to do
+    if (!socket->isOpen()) {
+        deleteLater();
+        return;
+    }
+
+    QByteArray data;
+    QString name;
+    bool isDir;
+    for (int i = 0; i < ListingBatchSize && nextEntry(name, isDir); ++i) {
+        if (json) {
+            if (count++) {
+                data.append(',');
+            }
+            data.append(QJsonDocument(QJsonObject{
+                {"name", name},
+                {"type", isDir ? "dir" : "file"}
+            }).toJson(QJsonDocument::Compact));
+        } else {
+            QByteArray escapedName = name.toHtmlEscaped().toUtf8();
+            if (isDir) {
+                escapedName.append('/');
+            }
+            data.append("<li><a href=\"");
+            data.append(escapedName);
+            data.append("\">");
+            data.append(escapedName);
+            data.append("</a></li>");
+        }
+    }
+
+    write(data);
+
+    // If entries remain, wait for the socket to write most of what it holds
+    // or otherwise continue at the next iteration of the event loop
+    if (next < entries.count() || iterator.hasNext()) {
+        if (QHttpSocketPrivate::get(socket)->pendingOutput() > ListingHighWaterMark) {
+            waiting = true;
+        } else {
+            QTimer::singleShot(0, this, &QFilesystemListingWriter::nextBatch);
+        }
+        return;
+    }
+
+    write(json ? QByteArray("]") : ListFooter);
+
+    // Store the complete listing in the cache if it fits
+    if (caching && handler) {
+        QFilesystemListing *listing = new QFilesystemListing;
+        listing->lastModified = lastModified;
+        listing->data = cacheData;
+        handler->listingCache.insert(key, listing, cacheData.length());
+    }
 
-    // Set the headers and write the content
-    socket->setHeader("Content-Type", "text/html");
-    socket->setHeader("Content-Length", QByteArray::number(data.length()));
-    socket->write(data);
     socket->close();
+    deleteLater();
+}
+
+void QFilesystemListingWriter::onBytesWritten()
+{
+    if (waiting && QHttpSocketPrivate::get(socket)->pendingOutput() <= ListingHighWaterMark) {
+        waiting = false;
+        nextBatch();
+    }
+}
+
+bool QFilesystemListingWriter::nextEntry(QString &name, bool &isDir)
+{
+    // Entries read ahead come first, after which the rest of the directory
+    // is read as it is rendered
+    if (next < entries.count()) {
+        name = entries.at(next).first;
+        isDir = entries.at(next).second;
+        if (++next == entries.count()) {
+            entries.clear();
+            next = 0;
+        }
+        return true;
+    }
+
+    if (iterator.hasNext()) {
+        iterator.next();
+        QFileInfo info = iterator.fileInfo();
+        name = info.fileName();
+        isDir = info.isDir();
+        return true;
+    }
+
+    return false;
+}
+
+void QFilesystemListingWriter::write(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    socket->write(data);
+
+    // Stop accumulating the listing as soon as it cannot fit in the cache
+    if (caching) {
+        if (!handler || cacheData.length() + data.length() > handler->listingCache.maxCost()) {
+            caching = false;
+            cacheData.clear();
+        } else {
+            cacheData.append(data);
+        }
+    }
 }
 
 QFilesystemHandler::QFilesystemHandler(QObject *parent)
@@ -161,6 +355,14 @@ QFilesystemHandler::QFilesystemHandler(const QString &documentRoot, QObject *par
 void QFilesystemHandler::setDocumentRoot(const QString &documentRoot)
 {
     d->documentRoot.setPath(documentRoot);
+
+    // Cached listings include paths relative to the old document root
+    d->listingCache.clear();
+}
+
+void QFilesystemHandler::setListingCacheSize(int size)
+{
+    d->listingCache.setMaxCost(size);
 }
 
 void QFilesystemHandler::process(QHttpSocket *socket, const QString &path)
@@ -23,13 +23,29 @@
 #ifndef QHTTPENGINE_QFILESYSTEMHANDLERPRIVATE_H
 #define QHTTPENGINE_QFILESYSTEMHANDLERPRIVATE_H
 
+#include <QCache>
+#include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
+#include <QList>
 #include <QMimeDatabase>
 #include <QObject>
+#include <QPair>
+#include <QPointer>
 
 #include <QHttpEngine/QFilesystemHandler>
 #include <QHttpEngine/QHttpSocket>
 
+// A directory listing that was fully rendered, along with the modification
+// time of the directory at the time it was rendered
+class QFilesystemListing
+{
+public:
+
+    QDateTime lastModified;
+    QByteArray data;
+};
+
 class QFilesystemHandlerPrivate : public QObject
 {
     Q_OBJECT
@@ -46,6 +62,56 @@ public:
 
     QDir documentRoot;
     QMimeDatabase database;
+
+    // JSON listings are keyed by absolute path and HTML listings by the
+    // requested path, which they include
+    QCache<QString, QFilesystemListing> listingCache;
+};
+
+// Streams a directory listing to the socket in batches, rendering the next
+// batch once the socket has written most of the previous ones, optionally
+// storing the result in the cache
+class QFilesystemListingWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    QFilesystemListingWriter(QFilesystemHandlerPrivate *handler, QHttpSocket *socket,
+                             const QString &key, const QString &path, const QString &absolutePath,
+                             bool json, const QDateTime &lastModified);
+
+    void start();
+
+private Q_SLOTS:
+
+    void nextBatch();
+    void onBytesWritten();
+
+private:
+
+    bool nextEntry(QString &name, bool &isDir);
+    void write(const QByteArray &data);
+
+    QPointer<QFilesystemHandlerPrivate> handler;
+    QHttpSocket *const socket;
+
+    const QString key;
+    const QString path;
+    const QString absolutePath;
+    const bool json;
+    const QDateTime lastModified;
+
+    // Entries read ahead of rendering (the name of each and whether it is
+    // a directory), which are sorted if the directory ended among them
+    QDirIterator iterator;
+    QList<QPair<QString, bool> > entries;
+    int next;
+    int count;
+    bool waiting;
+
+    bool caching;
+    QByteArray cacheData;
 };
 
 #endif // QHTTPENGINE_QFILESYSTEMHANDLERPRIVATE_H
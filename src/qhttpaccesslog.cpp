@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QDateTime>
+#include <QLocale>
+#include <QMutexLocker>
+#include <QTcpSocket>
+
+#include <QHttpEngine/QHttpAccessLog>
+#include <QHttpEngine/QHttpSocket>
+
+#include "qhttpaccesslog_p.h"
+#include "qhttpsocket_p.h"
+
+// Lines are handed to the writer once this much was collected
+const int BatchSize = 65536;
+
+const qint64 DefaultMaxPendingSize = 4 * 1024 * 1024;
+const int DefaultMaxFiles = 5;
+const int DefaultFlushInterval = 1000;
+
+static const char *methodName(QHttpSocket::Method method)
+{
+    switch (method) {
+    case QHttpSocket::OPTIONS: return "OPTIONS";
+    case QHttpSocket::GET: return "GET";
+    case QHttpSocket::HEAD: return "HEAD";
+    case QHttpSocket::POST: return "POST";
+    case QHttpSocket::PUT: return "PUT";
+    case QHttpSocket::DELETE: return "DELETE";
+    case QHttpSocket::TRACE: return "TRACE";
+    case QHttpSocket::CONNECT: return "CONNECT";
+    }
+    return "-";
+}
+
+// Append a value with quotes, backslashes and control characters escaped
+// so that a client cannot inject lines or fields
+static void appendEscaped(QByteArray &line, const QByteArray &value, bool json)
+{
+    static const char Hex[] = "0123456789abcdef";
+    const char *data = value.constData();
+    for (int i = 0; i < value.size(); ++i) {
+        uchar c = static_cast<uchar>(data[i]);
+        if (c == '"' || c == '\\') {
+            line.append('\\').append(static_cast<char>(c));
+        } else if (c < 0x20 || c == 0x7f) {
+            line.append(json ? "\\u00" : "\\x");
+            line.append(Hex[c >> 4]).append(Hex[c & 0xf]);
+        } else {
+            line.append(static_cast<char>(c));
+        }
+    }
+}
+
+QHttpAccessLogWriter::QHttpAccessLogWriter(const QString &fileName)
+    : droppedLines(0),
+      fileName(fileName),
+      pendingSize(0),
+      maxFileSize(0),
+      maxFiles(DefaultMaxFiles),
+      writing(false),
+      stopping(false)
+{
+}
+
+bool QHttpAccessLogWriter::enqueue(const QByteArray &data, int lines, qint64 maxPendingSize)
+{
+    QMutexLocker locker(&mutex);
+
+    // The lines are discarded rather than waiting for the writer
+    if (pendingSize + data.size() > maxPendingSize) {
+        droppedLines.fetchAndAddRelaxed(lines);
+        return false;
+    }
+
+    QHttpAccessLogBatch batch;
+    batch.data = data;
+    batch.lines = lines;
+    queue.append(batch);
+    pendingSize += data.size();
+    queued.wakeOne();
+
+    return true;
+}
+
+void QHttpAccessLogWriter::drain()
+{
+    QMutexLocker locker(&mutex);
+    while (!queue.isEmpty() || writing) {
+        written.wait(&mutex);
+    }
+}
+
+void QHttpAccessLogWriter::stop()
+{
+    mutex.lock();
+    stopping = true;
+    queued.wakeOne();
+    mutex.unlock();
+
+    wait();
+}
+
+void QHttpAccessLogWriter::setRotation(qint64 maxFileSize, int maxFiles)
+{
+    QMutexLocker locker(&mutex);
+    this->maxFileSize = maxFileSize;
+    this->maxFiles = maxFiles;
+}
+
+void QHttpAccessLogWriter::run()
+{
+    QMutexLocker locker(&mutex);
+    forever {
+        while (queue.isEmpty() && !stopping) {
+            queued.wait(&mutex);
+        }
+
+        // Everything queued is written before stopping
+        if (queue.isEmpty()) {
+            break;
+        }
+
+        QHttpAccessLogBatch batch = queue.takeFirst();
+        qint64 batchMaxFileSize = maxFileSize;
+        int batchMaxFiles = maxFiles;
+        writing = true;
+
+        locker.unlock();
+        write(batch, batchMaxFileSize, batchMaxFiles);
+        locker.relock();
+
+        pendingSize -= batch.data.size();
+        writing = false;
+        if (queue.isEmpty()) {
+            written.wakeAll();
+        }
+    }
+
+    file.close();
+}
+
+void QHttpAccessLogWriter::write(const QHttpAccessLogBatch &batch, qint64 maxFileSize, int maxFiles)
+{
+    if (file.isOpen() && maxFileSize > 0 && file.size() &&
+            file.size() + batch.data.size() > maxFileSize) {
+        rotate(maxFiles);
+    }
+
+    // Opening is attempted again for each batch if it fails
+    if (!file.isOpen()) {
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            droppedLines.fetchAndAddRelaxed(batch.lines);
+            return;
+        }
+    }
+
+    if (file.write(batch.data) != batch.data.size() || !file.flush()) {
+        droppedLines.fetchAndAddRelaxed(batch.lines);
+    }
+}
+
+void QHttpAccessLogWriter::rotate(int maxFiles)
+{
+    file.close();
+
+    // The oldest file is removed and the others are each moved up by one
+    QFile::remove(QString("%1.%2").arg(fileName).arg(maxFiles));
+    for (int i = maxFiles - 1; i > 0; --i) {
+        QFile::rename(QString("%1.%2").arg(fileName).arg(i),
+                      QString("%1.%2").arg(fileName).arg(i + 1));
+    }
+    if (maxFiles > 0) {
+        QFile::rename(fileName, fileName + ".1");
+    } else {
+        QFile::remove(fileName);
+    }
+}
+
+QHttpAccessLogPrivate::QHttpAccessLogPrivate(QHttpAccessLog *accessLog, const QString &fileName)
+    : QObject(accessLog),
+      format(QHttpAccessLog::CommonFormat),
+      sampleInterval(1),
+      sampleCount(0),
+      maxPendingSize(DefaultMaxPendingSize),
+      maxFileSize(0),
+      maxFiles(DefaultMaxFiles),
+      bufferLines(0),
+      timeSecond(-1),
+      writer(fileName),
+      q(accessLog)
+{
+    timer.setSingleShot(true);
+    timer.setInterval(DefaultFlushInterval);
+    connect(&timer, &QTimer::timeout, this, &QHttpAccessLogPrivate::handOff);
+
+    writer.start();
+}
+
+QHttpAccessLogPrivate::~QHttpAccessLogPrivate()
+{
+    handOff();
+    writer.stop();
+}
+
+void QHttpAccessLogPrivate::log(QHttpSocket *socket)
+{
+    QHttpSocketPrivate *socketPrivate = QHttpSocketPrivate::get(socket);
+    bool json = format == QHttpAccessLog::JsonFormat;
+
+    // Format the time of the current second if it changed
+    qint64 msecs = QDateTime::currentMSecsSinceEpoch();
+    if (msecs / 1000 != timeSecond) {
+        timeSecond = msecs / 1000;
+        QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(timeSecond * 1000, Qt::UTC);
+        timeString = json ?
+                dateTime.toString(Qt::ISODate).toLatin1() :
+                QLocale::c().toString(dateTime, "dd/MMM/yyyy:HH:mm:ss").toLatin1() + " +0000";
+    }
+
+    QByteArray address = socketPrivate->socket->peerAddress().toString().toLatin1();
+    QByteArray statusCode = QByteArray::number(socketPrivate->responseStatusCode);
+    QByteArray size = QByteArray::number(qMax(Q_INT64_C(0),
+            socketPrivate->bytesWritten - socketPrivate->responseHeaderSize));
+    QHttpSocket::HeaderMap headers = socket->headers();
+
+    if (buffer.isNull()) {
+        buffer.reserve(BatchSize);
+    }
+
+    if (json) {
+        qint64 duration = (socket->phaseTime(QHttpSocket::LastByteSentPhase) -
+                socket->phaseTime(QHttpSocket::HeadersParsedPhase)) / 1000;
+
+        buffer.append("{\"time\":\"").append(timeString);
+        buffer.append("\",\"remote_addr\":\"").append(address);
+        buffer.append("\",\"method\":\"").append(methodName(socket->method()));
+        buffer.append("\",\"path\":\"");
+        appendEscaped(buffer, socket->rawPath(), true);
+        buffer.append("\",\"status\":").append(statusCode);
+        buffer.append(",\"bytes_sent\":").append(size);
+        buffer.append(",\"duration_us\":").append(QByteArray::number(duration));
+        buffer.append(",\"referer\":\"");
+        appendEscaped(buffer, headers.value("Referer"), true);
+        buffer.append("\",\"user_agent\":\"");
+        appendEscaped(buffer, headers.value("User-Agent"), true);
+        buffer.append("\"}\n");
+    } else {
+        buffer.append(address).append(" - - [").append(timeString).append("] \"");
+        buffer.append(methodName(socket->method())).append(' ');
+        appendEscaped(buffer, socket->rawPath(), false);
+        buffer.append("\" ").append(statusCode).append(' ').append(size);
+
+        if (format == QHttpAccessLog::CombinedFormat) {
+            QByteArray referer = headers.value("Referer");
+            QByteArray userAgent = headers.value("User-Agent");
+            buffer.append(" \"");
+            appendEscaped(buffer, referer.isEmpty() ? QByteArray("-") : referer, false);
+            buffer.append("\" \"");
+            appendEscaped(buffer, userAgent.isEmpty() ? QByteArray("-") : userAgent, false);
+            buffer.append('"');
+        }
+        buffer.append('\n');
+    }
+    ++bufferLines;
+
+    if (buffer.size() >= BatchSize) {
+        handOff();
+    } else if (!timer.isActive()) {
+        timer.start();
+    }
+}
+
+void QHttpAccessLogPrivate::handOff()
+{
+    timer.stop();
+    if (!bufferLines) {
+        return;
+    }
+
+    // The batch is discarded if the writer has fallen too far behind
+    writer.enqueue(buffer, bufferLines, maxPendingSize);
+
+    buffer = QByteArray();
+    bufferLines = 0;
+}
+
+QHttpAccessLog::QHttpAccessLog(const QString &fileName, QObject *parent)
+    : QHttpMiddleware(parent),
+      d(new QHttpAccessLogPrivate(this, fileName))
+{
+}
+
+QHttpAccessLog::~QHttpAccessLog()
+{
+    // The private class hands off the remaining lines and stops the writer
+    // when it is destroyed along with the other children
+}
+
+void QHttpAccessLog::setFormat(Format format)
+{
+    d->format = format;
+
+    // The cached time is formatted differently for each format
+    d->timeSecond = -1;
+}
+
+void QHttpAccessLog::setSampleInterval(int interval)
+{
+    d->sampleInterval = qMax(1, interval);
+}
+
+void QHttpAccessLog::setMaxFileSize(qint64 size)
+{
+    d->maxFileSize = size;
+    d->writer.setRotation(d->maxFileSize, d->maxFiles);
+}
+
+void QHttpAccessLog::setMaxFiles(int count)
+{
+    d->maxFiles = count;
+    d->writer.setRotation(d->maxFileSize, d->maxFiles);
+}
+
+void QHttpAccessLog::setMaxPendingSize(qint64 size)
+{
+    d->maxPendingSize = size;
+}
+
+void QHttpAccessLog::setFlushInterval(int msec)
+{
+    d->timer.setInterval(msec);
+}
+
+qint64 QHttpAccessLog::droppedLines() const
+{
+    return d->writer.droppedLines.load();
+}
+
+void QHttpAccessLog::flush()
+{
+    d->handOff();
+    d->writer.drain();
+}
+
+bool QHttpAccessLog::process(QHttpSocket *socket)
+{
+    // Only one in every sampleInterval requests is logged
+    bool sampled = d->sampleCount == 0;
+    d->sampleCount = (d->sampleCount + 1) % d->sampleInterval;
+
+    if (sampled) {
+        QHttpAccessLogPrivate *accessLog = d;
+        connect(socket, &QHttpSocket::requestCompleted, d, [accessLog, socket]() {
+            accessLog->log(socket);
+        });
+    }
+
+    return true;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QHTTPENGINE_QHTTPACCESSLOGPRIVATE_H
+#define QHTTPENGINE_QHTTPACCESSLOGPRIVATE_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
+
+#include "QHttpEngine/qhttpaccesslog.h"
+
+class QHttpAccessLogBatch
+{
+public:
+
+    QByteArray data;
+    int lines;
+};
+
+// Thread that writes batches of lines to the file - the queue is the only
+// state shared with the thread producing the lines and is locked once for
+// each batch rather than for each line
+class QHttpAccessLogWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    explicit QHttpAccessLogWriter(const QString &fileName);
+
+    // Queue a batch, discarding it if too much data is waiting
+    bool enqueue(const QByteArray &data, int lines, qint64 maxPendingSize);
+
+    // Wait until all queued batches were written
+    void drain();
+
+    void stop();
+
+    void setRotation(qint64 maxFileSize, int maxFiles);
+
+    QAtomicInteger<qint64> droppedLines;
+
+protected:
+
+    virtual void run();
+
+private:
+
+    void write(const QHttpAccessLogBatch &batch, qint64 maxFileSize, int maxFiles);
+    void rotate(int maxFiles);
+
+    QString fileName;
+    QFile file;
+
+    QMutex mutex;
+    QWaitCondition queued;
+    QWaitCondition written;
+    QList<QHttpAccessLogBatch> queue;
+    qint64 pendingSize;
+    qint64 maxFileSize;
+    int maxFiles;
+    bool writing;
+    bool stopping;
+};
+
+class QHttpAccessLogPrivate : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    QHttpAccessLogPrivate(QHttpAccessLog *accessLog, const QString &fileName);
+    virtual ~QHttpAccessLogPrivate();
+
+    void log(QHttpSocket *socket);
+
+    QHttpAccessLog::Format format;
+    int sampleInterval;
+    int sampleCount;
+    qint64 maxPendingSize;
+    qint64 maxFileSize;
+    int maxFiles;
+
+    // Lines that were not yet handed to the writer
+    QByteArray buffer;
+    int bufferLines;
+
+    // The timestamp is only formatted once per second
+    qint64 timeSecond;
+    QByteArray timeString;
+
+    QTimer timer;
+    QHttpAccessLogWriter writer;
+
+public Q_SLOTS:
+
+    void handOff();
+
+private:
+
+    QHttpAccessLog *const q;
+};
+
+#endif // QHTTPENGINE_QHTTPACCESSLOGPRIVATE_H
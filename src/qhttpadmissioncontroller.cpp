@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "qhttpadmissioncontroller_p.h"
+#include "qhttptimerwheel_p.h"
+
+QHttpAdmissionController::QHttpAdmissionController(int target, int interval, QObject *parent)
+    : QObject(parent),
+      clock(QHttpTimerWheel::instance()),
+      lag(0),
+      firstAboveTime(-1),
+      overloaded(false),
+      requestsSinceProbe(false)
+{
+    // The event loop lag is measured by comparing when the probe was
+    // expected to fire with when it actually did - the probe only runs
+    // while requests are arriving
+    probe.setTimerType(Qt::PreciseTimer);
+    connect(&probe, &QTimer::timeout, this, &QHttpAdmissionController::onProbe);
+
+    setParameters(target, interval);
+}
+
+void QHttpAdmissionController::setParameters(int target, int interval)
+{
+    this->target = target;
+    this->interval = interval;
+
+    if (probe.isActive()) {
+        lastProbe = clock->now();
+        probe.start(interval);
+    }
+}
+
+bool QHttpAdmissionController::admit(qint64 headersTime)
+{
+    qint64 now = clock->now();
+    if (!probe.isActive()) {
+        lag = 0;
+        lastProbe = now;
+        probe.start(interval);
+    }
+    requestsSinceProbe = true;
+
+    qint64 delay = now - headersTime + lag;
+    sample(now, delay);
+
+    return !overloaded || delay < target;
+}
+
+void QHttpAdmissionController::onProbe()
+{
+    qint64 now = clock->now();
+    lag = qMax(Q_INT64_C(0), now - lastProbe - interval);
+    lastProbe = now;
+
+    sample(now, lag);
+
+    // Stop once no requests arrived during the interval and the delay is
+    // back below the target
+    if (!requestsSinceProbe && !overloaded) {
+        probe.stop();
+    }
+    requestsSinceProbe = false;
+}
+
+void QHttpAdmissionController::sample(qint64 now, qint64 delay)
+{
+    // A single delay below the target indicates that the queue drained
+    if (delay < target) {
+        firstAboveTime = -1;
+        overloaded = false;
+    } else if (firstAboveTime == -1) {
+        firstAboveTime = now + interval;
+    } else if (now >= firstAboveTime) {
+        overloaded = true;
+    }
+}
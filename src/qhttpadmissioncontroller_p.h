@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef QHTTPENGINE_QHTTPADMISSIONCONTROLLERPRIVATE_H
+#define QHTTPENGINE_QHTTPADMISSIONCONTROLLERPRIVATE_H
+
+#include <QObject>
+#include <QTimer>
+
+class QHttpTimerWheel;
+
+// Requests are admitted based on how long they have been queued, following
+// the approach of CoDel: the delay of each request (the time since its
+// headers were received plus the current event loop lag) is compared to a
+// target. Only once the delay has stayed above the target for an entire
+// interval is the handler considered overloaded. While overloaded, requests
+// that were queued for longer than the target should be shed, since they are
+// the least likely to be answered in time.
+class QHttpAdmissionController : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    QHttpAdmissionController(int target, int interval, QObject *parent);
+
+    void setParameters(int target, int interval);
+
+    // Determine whether the request whose headers were received at the
+    // specified time should be processed
+    bool admit(qint64 headersTime);
+
+private Q_SLOTS:
+
+    void onProbe();
+
+private:
+
+    void sample(qint64 now, qint64 delay);
+
+    QHttpTimerWheel *clock;
+    QTimer probe;
+    int target;
+    int interval;
+
+    qint64 lastProbe;
+    qint64 lag;
+    qint64 firstAboveTime;
+    bool overloaded;
+    bool requestsSinceProbe;
+};
+
+#endif // QHTTPENGINE_QHTTPADMISSIONCONTROLLERPRIVATE_H
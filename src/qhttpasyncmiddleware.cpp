@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <QTcpSocket>
+
+#include <QHttpEngine/QHttpAsyncMiddleware>
+#include <QHttpEngine/QHttpSocket>
+
+#include "qhttpasyncmiddleware_p.h"
+#include "qhttpsocket_p.h"
+
+// Time allowed for a decision (in milliseconds)
+const int DefaultTimeout = 30000;
+
+QHttpPendingDecision::QHttpPendingDecision(QHttpAsyncMiddlewarePrivate *middleware, QHttpSocket *socket)
+    : middleware(middleware),
+      socket(socket)
+{
+}
+
+QHttpPendingDecision::~QHttpPendingDecision()
+{
+    QObject::disconnect(disconnectedConnection);
+    QObject::disconnect(destroyedConnection);
+}
+
+void QHttpPendingDecision::expire()
+{
+    middleware->abandon(socket, true);
+}
+
+QHttpAsyncMiddlewarePrivate::QHttpAsyncMiddlewarePrivate(QHttpAsyncMiddleware *middleware)
+    : QObject(middleware),
+      timeout(DefaultTimeout),
+      q(middleware)
+{
+}
+
+QHttpAsyncMiddlewarePrivate::~QHttpAsyncMiddlewarePrivate()
+{
+    qDeleteAll(pending);
+}
+
+void QHttpAsyncMiddlewarePrivate::begin(QHttpSocket *socket, const std::function<void()> &resume)
+{
+    // Only one decision can be pending for a socket at a time, so any
+    // previous one is cancelled before being replaced
+    abandon(socket, false);
+
+    QHttpPendingDecision *decision = new QHttpPendingDecision(this, socket);
+    decision->resume = resume;
+    pending.insert(socket, decision);
+
+    // Abandon the decision as soon as the client disconnects
+    decision->disconnectedConnection = connect(QHttpSocketPrivate::get(socket)->socket, &QTcpSocket::disconnected, this, [this, socket]() {
+        abandon(socket, false);
+    });
+    decision->destroyedConnection = connect(socket, &QHttpSocket::destroyed, this, [this, socket]() {
+        abandon(socket, false);
+    });
+
+    if (timeout >= 0) {
+        QHttpTimerWheel *wheel = QHttpTimerWheel::instance();
+        wheel->schedule(decision, wheel->now() + timeout);
+    }
+
+    q->start(socket);
+}
+
+void QHttpAsyncMiddlewarePrivate::finish(QHttpSocket *socket, bool proceed)
+{
+    QHttpPendingDecision *decision = pending.take(socket);
+    if (!decision) {
+        return;
+    }
+
+    std::function<void()> resume = decision->resume;
+    delete decision;
+
+    if (proceed && resume) {
+        resume();
+    }
+}
+
+void QHttpAsyncMiddlewarePrivate::abandon(QHttpSocket *socket, bool timedOut)
+{
+    QHttpPendingDecision *decision = pending.take(socket);
+    if (!decision) {
+        return;
+    }
+    delete decision;
+
+    q->cancel(socket);
+
+    if (timedOut) {
+        socket->writeError(QHttpSocket::GatewayTimeout);
+    }
+}
+
+QHttpAsyncMiddleware::QHttpAsyncMiddleware(QObject *parent)
+    : QHttpMiddleware(parent),
+      d(new QHttpAsyncMiddlewarePrivate(this))
+{
+}
+
+void QHttpAsyncMiddleware::setTimeout(int msecs)
+{
+    d->timeout = msecs;
+}
+
+bool QHttpAsyncMiddleware::process(QHttpSocket *socket)
+{
+    d->begin(socket, std::function<void()>());
+    return false;
+}
+
+void QHttpAsyncMiddleware::cancel(QHttpSocket *)
+{
+}
+
+void QHttpAsyncMiddleware::finish(QHttpSocket *socket, bool proceed)
+{
+    d->finish(socket, proceed);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef QHTTPENGINE_QHTTPASYNCMIDDLEWAREPRIVATE_H
+#define QHTTPENGINE_QHTTPASYNCMIDDLEWAREPRIVATE_H
+
+#include <functional>
+
+#include <QHash>
+#include <QObject>
+
+#include "QHttpEngine/qhttpasyncmiddleware.h"
+
+#include "qhttptimerwheel_p.h"
+
+class QHttpAsyncMiddlewarePrivate;
+
+// A decision that has not yet been made for a socket, which expires once
+// the timeout passes
+class QHttpPendingDecision : public QHttpTimerWheel::Entry
+{
+public:
+
+    QHttpPendingDecision(QHttpAsyncMiddlewarePrivate *middleware, QHttpSocket *socket);
+    virtual ~QHttpPendingDecision();
+
+    virtual void expire();
+
+    QHttpAsyncMiddlewarePrivate *middleware;
+    QHttpSocket *socket;
+    std::function<void()> resume;
+
+    QMetaObject::Connection disconnectedConnection;
+    QMetaObject::Connection destroyedConnection;
+};
+
+class QHttpAsyncMiddlewarePrivate : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit QHttpAsyncMiddlewarePrivate(QHttpAsyncMiddleware *middleware);
+    virtual ~QHttpAsyncMiddlewarePrivate();
+
+    static QHttpAsyncMiddlewarePrivate *get(QHttpAsyncMiddleware *middleware) { return middleware->d; }
+
+    // Begin processing the request, invoking resume if it may continue
+    void begin(QHttpSocket *socket, const std::function<void()> &resume);
+    void finish(QHttpSocket *socket, bool proceed);
+    void abandon(QHttpSocket *socket, bool timedOut);
+
+    int timeout;
+    QHash<QHttpSocket*, QHttpPendingDecision*> pending;
+
+private:
+
+    QHttpAsyncMiddleware *const q;
+};
+
+#endif // QHTTPENGINE_QHTTPASYNCMIDDLEWAREPRIVATE_H
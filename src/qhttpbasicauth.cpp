@@ -20,6 +20,11 @@
  * IN THE SOFTWARE.
  */
 
+#include <QCryptographicHash>
+#include <QList>
+#include <QMessageAuthenticationCode>
+#include <QUuid>
+
 #include <QHttpEngine/QHttpBasicAuth>
 #include <QHttpEngine/QHttpParser>
 #include <QHttpEngine/QHttpSocket>
@@ -27,12 +32,126 @@
 
 #include "qhttpbasicauth_p.h"
 
+const QByteArray HashAlgorithm = "pbkdf2-sha256";
+const int DefaultIterations = 10000;
+const int DefaultCacheSize = 1024;
+
+// Generate random bytes for salts and keys - QUuid uses the system's source
+// of randomness where one is available
+static QByteArray randomBytes()
+{
+    return QUuid::createUuid().toRfc4122();
+}
+
+// Compare the contents of two arrays in an amount of time that depends only
+// on their length
+static bool constantTimeEquals(const QByteArray &a, const QByteArray &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    uchar result = 0;
+    for (int i = 0; i < a.size(); ++i) {
+        result |= static_cast<uchar>(a.at(i) ^ b.at(i));
+    }
+    return result == 0;
+}
+
+// Derive a key from the password as described in RFC 2898
+static QByteArray pbkdf2(const QByteArray &password, const QByteArray &salt, int iterations, int length)
+{
+    QMessageAuthenticationCode mac(QCryptographicHash::Sha256, password);
+    QByteArray key;
+    for (quint32 block = 1; key.size() < length; ++block) {
+        const char index[] = {
+            static_cast<char>(block >> 24),
+            static_cast<char>(block >> 16),
+            static_cast<char>(block >> 8),
+            static_cast<char>(block)
+        };
+        mac.reset();
+        mac.addData(salt);
+        mac.addData(index, sizeof(index));
+        QByteArray u = mac.result();
+        QByteArray t = u;
+        for (int i = 1; i < iterations; ++i) {
+            mac.reset();
+            mac.addData(u);
+            u = mac.result();
+            for (int j = 0; j < t.size(); ++j) {
+                t[j] = t.at(j) ^ u.at(j);
+            }
+        }
+        key.append(t);
+    }
+    return key.left(length);
+}
+
+QHttpCredential QHttpCredential::create(const QString &password, int iterations)
+{
+    QHttpCredential credential;
+    credential.salt = randomBytes();
+    credential.iterations = iterations;
+    credential.hash = pbkdf2(password.toUtf8(), credential.salt, iterations, 32);
+    return credential;
+}
+
+bool QHttpCredential::parse(const QByteArray &encoded, QHttpCredential &credential)
+{
+    QList<QByteArray> parts = encoded.split('$');
+    if (parts.count() != 4 || parts.at(0) != HashAlgorithm) {
+        return false;
+    }
+
+    bool ok;
+    credential.iterations = parts.at(1).toInt(&ok);
+    credential.salt = QByteArray::fromBase64(parts.at(2));
+    credential.hash = QByteArray::fromBase64(parts.at(3));
+    return ok && credential.iterations > 0 && !credential.hash.isEmpty();
+}
+
+QByteArray QHttpCredential::encode() const
+{
+    return HashAlgorithm + "$" + QByteArray::number(iterations) + "$" +
+            salt.toBase64() + "$" + hash.toBase64();
+}
+
+bool QHttpCredential::matches(const QString &password) const
+{
+    return constantTimeEquals(pbkdf2(password.toUtf8(), salt, iterations, hash.size()), hash);
+}
+
 QHttpBasicAuthPrivate::QHttpBasicAuthPrivate(QObject *parent, const QString &realm)
     : QObject(parent),
-      realm(realm)
+      realm(realm),
+      cacheKey(randomBytes() + randomBytes()),
+      cacheSize(DefaultCacheSize),
+      cacheUse(0)
 {
 }
 
+QByteArray QHttpBasicAuthPrivate::digest(const QString &username, const QString &password) const
+{
+    return QMessageAuthenticationCode::hash(username.toUtf8() + ':' + password.toUtf8(),
+                                            cacheKey, QCryptographicHash::Sha256);
+}
+
+void QHttpBasicAuthPrivate::remember(const QByteArray &digest)
+{
+    // Replace the least recently used entry once the cache is full - this
+    // only happens after deriving a hash, which costs far more than the scan
+    if (cache.count() >= cacheSize) {
+        auto oldest = cache.begin();
+        for (auto i = cache.begin(); i != cache.end(); ++i) {
+            if (i.value() < oldest.value()) {
+                oldest = i;
+            }
+        }
+        cache.erase(oldest);
+    }
+    cache.insert(digest, ++cacheUse);
+}
+
 QHttpBasicAuth::QHttpBasicAuth(const QString &realm, QObject *parent)
     : QHttpMiddleware(parent),
       d(new QHttpBasicAuthPrivate(this, realm))
@@ -41,18 +160,73 @@ QHttpBasicAuth::QHttpBasicAuth(const QString &realm, QObject *parent)
 
 void QHttpBasicAuth::add(const QString &username, const QString &password)
 {
-    d->map.insert(username, password);
+    QHttpCredential credential = QHttpCredential::create(password, DefaultIterations);
+    d->credentials.insert(username, credential);
+    d->cache.clear();
+
+    if (d->dummy.hash.isEmpty()) {
+        d->dummy = credential;
+    }
+}
+
+bool QHttpBasicAuth::addHash(const QString &username, const QByteArray &hash)
+{
+    QHttpCredential credential;
+    if (!QHttpCredential::parse(hash, credential)) {
+        return false;
+    }
+    d->credentials.insert(username, credential);
+    d->cache.clear();
+
+    if (d->dummy.hash.isEmpty()) {
+        d->dummy = credential;
+    }
+    return true;
+}
+
+void QHttpBasicAuth::setCacheSize(int size)
+{
+    d->cacheSize = size;
+    d->cache.clear();
+}
+
+QByteArray QHttpBasicAuth::hashPassword(const QString &password, int iterations)
+{
+    return QHttpCredential::create(password, iterations).encode();
 }
 
 bool QHttpBasicAuth::verify(const QString &username, const QString &password)
 {
-    return d->map.contains(username) && d->map.value(username) == password;
+    // Check if the credentials were already verified
+    QByteArray digest;
+    if (d->cacheSize > 0) {
+        digest = d->digest(username, password);
+        auto i = d->cache.find(digest);
+        if (i != d->cache.end()) {
+            i.value() = ++d->cacheUse;
+            return true;
+        }
+    }
+
+    // Unknown usernames are checked against a dummy credential so that
+    // they cannot be distinguished by the time taken to reject them
+    auto i = d->credentials.constFind(username);
+    bool found = i != d->credentials.constEnd();
+    bool matches = (found ? i.value() : d->dummy).matches(password);
+
+    // Remember the credentials if they are valid
+    if (found && matches && !digest.isNull()) {
+        d->remember(digest);
+    }
+    return found && matches;
 }
 
 bool QHttpBasicAuth::process(QHttpSocket *socket)
 {
+    QByteArray header = socket->headers().value("Authorization");
+
     // Attempt to extract credentials from the header
-    QByteArrayList headerParts = socket->headers().value("Authorization").split(' ');
+    QByteArrayList headerParts = header.split(' ');
     if (headerParts.count() == 2 && headerParts.at(0) == QIByteArray("Basic")) {
 
         // Decode the credentials and split into username/password
@@ -23,8 +23,27 @@
 #ifndef QHTTPENGINE_QHTTPBASICAUTHPRIVATE_H
 #define QHTTPENGINE_QHTTPBASICAUTHPRIVATE_H
 
-#include <QMap>
+#include <QByteArray>
+#include <QHash>
 #include <QObject>
+#include <QString>
+
+class QHttpCredential
+{
+public:
+
+    QHttpCredential() : iterations(0) {}
+
+    static QHttpCredential create(const QString &password, int iterations);
+    static bool parse(const QByteArray &encoded, QHttpCredential &credential);
+
+    QByteArray encode() const;
+    bool matches(const QString &password) const;
+
+    QByteArray salt;
+    int iterations;
+    QByteArray hash;
+};
 
 class QHttpBasicAuthPrivate : public QObject
 {
@@ -34,8 +53,21 @@ public:
 
     explicit QHttpBasicAuthPrivate(QObject *parent, const QString &realm);
 
+    QByteArray digest(const QString &username, const QString &password) const;
+    void remember(const QByteArray &digest);
+
     const QString realm;
-    QMap<QString, QString> map;
+    QHash<QString, QHttpCredential> credentials;
+
+    // Used for unknown usernames so they take as long to reject as
+    // incorrect passwords
+    QHttpCredential dummy;
+
+    // Digests of verified credentials mapped to the time they were last used
+    QByteArray cacheKey;
+    int cacheSize;
+    quint64 cacheUse;
+    QHash<QByteArray, quint64> cache;
 };
 
 #endif // QHTTPENGINE_QHTTPBASICAUTHPRIVATE_H
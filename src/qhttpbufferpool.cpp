@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QThreadStorage>
+#include <QVector>
+
+#include "qhttpbufferpool_p.h"
+
+// Capacity of new buffers, which is enough for the headers of most requests
+const int InitialCapacity = 4096;
+
+// Largest buffer that is kept and number of buffers kept for each thread
+const int MaxCapacity = 64 * 1024;
+const int MaxBuffers = 256;
+
+typedef QVector<QByteArray> QHttpBufferList;
+
+static QHttpBufferList *buffers()
+{
+    static QThreadStorage<QHttpBufferList*> storage;
+    if (!storage.hasLocalData()) {
+        storage.setLocalData(new QHttpBufferList);
+    }
+    return storage.localData();
+}
+
+void QHttpBufferPool::acquire(QByteArray &buffer)
+{
+    if (buffer.capacity()) {
+        return;
+    }
+
+    QHttpBufferList *list = buffers();
+    if (list->isEmpty()) {
+        buffer.reserve(InitialCapacity);
+    } else {
+        buffer = list->takeLast();
+    }
+}
+
+void QHttpBufferPool::release(QByteArray &buffer)
+{
+    // Only buffers that are not shared can be reused, since clearing one
+    // that is would allocate a new one - reserving capacity ensures that
+    // resizing it does not give up the memory
+    QHttpBufferList *list = buffers();
+    if (buffer.isDetached() && buffer.capacity() && buffer.capacity() <= MaxCapacity &&
+            list->size() < MaxBuffers) {
+        buffer.reserve(buffer.capacity());
+        buffer.resize(0);
+        list->append(buffer);
+    }
+    buffer = QByteArray();
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QHTTPENGINE_QHTTPBUFFERPOOLPRIVATE_H
+#define QHTTPENGINE_QHTTPBUFFERPOOLPRIVATE_H
+
+#include <QByteArray>
+
+// Buffers used by connections are returned to a pool for the thread as soon
+// as they are empty and handed out again with their capacity intact, so that
+// a busy server does not repeatedly allocate and grow them while an idle
+// connection holds no buffer at all. Buffers that grew very large are not
+// kept.
+class QHttpBufferPool
+{
+public:
+
+    // Provide the buffer with storage from the pool if it has none
+    static void acquire(QByteArray &buffer);
+
+    // Return the storage of the buffer to the pool, leaving it null
+    static void release(QByteArray &buffer);
+};
+
+#endif // QHTTPENGINE_QHTTPBUFFERPOOLPRIVATE_H
@@ -20,16 +20,148 @@
  * IN THE SOFTWARE.
  */
 
+#include <QPointer>
+
+#include <QHttpEngine/QHttpAsyncMiddleware>
 #include <QHttpEngine/QHttpHandler>
 #include <QHttpEngine/QHttpMiddleware>
 #include <QHttpEngine/QHttpSocket>
 
+#include "qhttpasyncmiddleware_p.h"
 #include "qhttphandler_p.h"
+#include "qhttpmetrics_p.h"
+
+QHttpRedirect::QHttpRedirect(const QString &path)
+    : path(path)
+{
+    QString part;
+    for (int i = 0; i < path.length(); ++i) {
+
+        // Check for "%" followed by one or two digits
+        int capture = 0;
+        int j = i + 1;
+        while (j < path.length() && j < i + 3 && path.at(j).isDigit()) {
+            capture = capture * 10 + path.at(j).digitValue();
+            ++j;
+        }
+
+        if (path.at(i) == '%' && capture > 0) {
+            parts.append(part);
+            captures.append(capture);
+            part.clear();
+            i = j - 1;
+        } else {
+            part.append(path.at(i));
+        }
+    }
+    parts.append(part);
+
+    response.data = "HTTP/1.0 302 " + QHttpStatus::reason(QHttpSocket::Found) + "\r\n";
+    response.statusLength = response.data.length();
+    response.data += "Location: " + path.toUtf8() + "\r\n" +
+            "\r\n";
+    response.headerLength = response.data.length();
+}
 
 QHttpHandlerPrivate::QHttpHandlerPrivate(QHttpHandler *handler)
     : QObject(handler),
+      admissionController(0),
+      shedCount(0),
+      metricsHandler(-1),
       q(handler)
 {
+    for (int i = 0; i < LimitCount; ++i) {
+        limits[i] = -1;
+    }
+}
+
+int QHttpHandlerPrivate::metricsIndex()
+{
+    if (metricsHandler == -1) {
+        metricsHandler = QHttpMetrics::handlerIndex(
+            q->objectName().isEmpty() ? QString(q->metaObject()->className()) : q->objectName()
+        );
+    }
+    return metricsHandler;
+}
+
+void QHttpHandlerPrivate::runMiddleware(QHttpSocket *socket, const QString &path, int index)
+{
+    for (; index < middleware.count(); ++index) {
+
+        // Asynchronous middleware resumes with the next middleware once it
+        // completes, provided the handler still exists
+        QHttpAsyncMiddleware *asyncMiddleware = qobject_cast<QHttpAsyncMiddleware*>(middleware.at(index));
+        if (asyncMiddleware) {
+            QPointer<QHttpHandlerPrivate> handler(this);
+            int next = index + 1;
+            QHttpAsyncMiddlewarePrivate::get(asyncMiddleware)->begin(socket, [handler, socket, path, next]() {
+                if (handler) {
+                    handler->runMiddleware(socket, path, next);
+                }
+            });
+            return;
+        }
+
+        if (!middleware.at(index)->process(socket)) {
+            return;
+        }
+    }
+
+    dispatch(socket, path);
+}
+
+void QHttpHandlerPrivate::dispatch(QHttpSocket *socket, const QString &path)
+{
+    int matchedLength;
+
+    // Check the redirects for a match
+    int index = redirectRouter.match(path, matchedLength);
+    if (index != -1) {
+        const QHttpRedirect &redirect = redirects.at(index);
+        QString newPath;
+        switch (redirectRouter.type(index)) {
+        case QHttpRouter::Literal:
+            if (QHttpSocketPrivate::get(socket)->writeResponse(redirect.response)) {
+                socket->close();
+                return;
+            }
+            newPath = redirect.path;
+            break;
+        case QHttpRouter::RegExp:
+            newPath = redirect.path;
+            foreach (QString replacement, redirectRouter.regExp(index).capturedTexts().mid(1)) {
+                newPath = newPath.arg(replacement);
+            }
+            break;
+        case QHttpRouter::RegularExpression:
+        {
+            // Captured texts are appended by reference without being copied
+            const QRegularExpressionMatch &match = redirectRouter.lastMatch();
+            newPath.append(redirect.parts.at(0));
+            for (int i = 0; i < redirect.captures.count(); ++i) {
+                newPath.append(match.capturedRef(redirect.captures.at(i)));
+                newPath.append(redirect.parts.at(i + 1));
+            }
+            break;
+        }
+        }
+        socket->writeRedirect(newPath.toUtf8());
+        return;
+    }
+
+    // Check the sub-handlers for a match
+    index = subHandlerRouter.match(path, matchedLength);
+    if (index != -1) {
+        subHandlers.at(index)->route(socket, path.mid(matchedLength));
+        return;
+    }
+
+    // If no match, invoke the process() method
+    qint64 *phases = QHttpSocketPrivate::get(socket)->phases;
+    phases[QHttpSocket::DispatchedPhase] = QHttpMetrics::now();
+    q->process(socket, path);
+    phases[QHttpSocket::HandlerReturnedPhase] = QHttpMetrics::now();
 }
 
 QHttpHandler::QHttpHandler(QObject *parent)
@@ -45,45 +177,82 @@ void QHttpHandler::addMiddleware(QHttpMiddleware *middleware)
 
 void QHttpHandler::addRedirect(const QRegExp &pattern, const QString &path)
 {
-    d->redirects.append(Redirect(pattern, path));
+    d->redirectRouter.add(pattern);
+    d->redirects.append(QHttpRedirect(path));
+}
+
+void QHttpHandler::addRedirect(const QRegularExpression &pattern, const QString &path)
+{
+    d->redirectRouter.add(pattern);
+    d->redirects.append(QHttpRedirect(path));
 }
 
 void QHttpHandler::addSubHandler(const QRegExp &pattern, QHttpHandler *handler)
 {
-    d->subHandlers.append(SubHandler(pattern, handler));
+    d->subHandlerRouter.add(pattern);
+    d->subHandlers.append(handler);
 }
 
-void QHttpHandler::route(QHttpSocket *socket, const QString &path)
+void QHttpHandler::addSubHandler(const QRegularExpression &pattern, QHttpHandler *handler)
 {
-    // Run through each of the middleware
-    foreach (QHttpMiddleware *middleware, d->middleware) {
-        if (!middleware->process(socket)) {
-            return;
-        }
+    d->subHandlerRouter.add(pattern);
+    d->subHandlers.append(handler);
+}
+
+void QHttpHandler::setLimit(QHttpSocket::Limit limit, qint64 value)
+{
+    d->limits[limit] = value;
+}
+
+void QHttpHandler::setAdmissionControl(int target, int interval)
+{
+    if (target < 0) {
+        delete d->admissionController;
+        d->admissionController = 0;
+    } else if (d->admissionController) {
+        d->admissionController->setParameters(target, interval);
+    } else {
+        d->admissionController = new QHttpAdmissionController(target, interval, d);
     }
+}
 
-    // Check each of the redirects for a match
-    foreach (Redirect redirect, d->redirects) {
-        if (redirect.first.indexIn(path) != -1) {
-            QString newPath = redirect.second;
-            foreach (QString replacement, redirect.first.capturedTexts().mid(1)) {
-                newPath = newPath.arg(replacement);
-            }
-            socket->writeRedirect(newPath.toUtf8());
-            return;
-        }
+void QHttpHandler::addCriticalRoute(const QRegularExpression &pattern)
+{
+    d->criticalRouter.add(pattern);
+}
+
+qint64 QHttpHandler::shedCount() const
+{
+    return d->shedCount;
+}
+
+void QHttpHandler::route(QHttpSocket *socket, const QString &path)
+{
+    QHttpSocketPrivate *socketPrivate = QHttpSocketPrivate::get(socket);
+
+    // The response is attributed to the last handler the request reaches
+    socketPrivate->metricsHandler = d->metricsIndex();
+
+    // Reject the request if it exceeds any of the limits for this handler
+    if (!socketPrivate->checkLimits(d->limits)) {
+        return;
     }
 
-    // Check each of the sub-handlers for a match
-    foreach (SubHandler subHandler, d->subHandlers) {
-        if (subHandler.first.indexIn(path) != -1) {
-            subHandler.second->route(socket, path.mid(subHandler.first.matchedLength()));
-            return;
-        }
+    int matchedLength;
+
+    // Shed the request if the handler is overloaded, unless the route is
+    // critical
+    if (d->admissionController &&
+            !d->admissionController->admit(socketPrivate->headersTime) &&
+            d->criticalRouter.match(path, matchedLength) == -1) {
+        ++d->shedCount;
+        socket->setHeader("Retry-After", "1");
+        socket->writeError(QHttpSocket::ServiceUnavailable);
+        return;
     }
 
-    // If no match, invoke the process() method
-    process(socket, path);
+    // Run through the middleware and then dispatch the request
+    d->runMiddleware(socket, path, 0);
 }
 
 void QHttpHandler::process(QHttpSocket *socket, const QString &)
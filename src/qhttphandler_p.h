@@ -25,13 +25,34 @@
 
 #include <QList>
 #include <QObject>
-#include <QPair>
-#include <QRegExp>
+#include <QStringList>
+#include <QVector>
 
 #include "QHttpEngine/qhttphandler.h"
 
-typedef QPair<QRegExp, QString> Redirect;
-typedef QPair<QRegExp, QHttpHandler*> SubHandler;
+#include "qhttpadmissioncontroller_p.h"
+#include "qhttpresponses_p.h"
+#include "qhttprouter_p.h"
+#include "qhttpsocket_p.h"
+
+// The destination of a redirect is split into literal text and references
+// to captured texts ("%1", "%2", etc.) when it is added so that the new path
+// can be assembled directly from a QRegularExpressionMatch - if the pattern
+// has no captures, the entire response is built in advance
+class QHttpRedirect
+{
+public:
+
+    QHttpRedirect() {}
+    explicit QHttpRedirect(const QString &path);
+
+    QString path;
+    QStringList parts;
+    QVector<int> captures;
+
+    // Complete response used when the destination is a literal path
+    QHttpResponse response;
+};
 
 class QHttpHandlerPrivate : public QObject
 {
@@ -41,10 +62,30 @@ public:
 
     explicit QHttpHandlerPrivate(QHttpHandler *handler);
 
-    QList<Redirect> redirects;
-    QList<SubHandler> subHandlers;
+    // Run the middleware beginning with the one at the specified index and
+    // dispatch the request if all of them allow it to continue
+    void runMiddleware(QHttpSocket *socket, const QString &path, int index);
+    void dispatch(QHttpSocket *socket, const QString &path);
+
+    // The routers map patterns to an index in the corresponding list
+    QHttpRouter redirectRouter;
+    QList<QHttpRedirect> redirects;
+    QHttpRouter subHandlerRouter;
+    QList<QHttpHandler*> subHandlers;
+
     QList<QHttpMiddleware*> middleware;
 
+    qint64 limits[LimitCount];
+
+    // Created once admission control is enabled
+    QHttpAdmissionController *admissionController;
+    QHttpRouter criticalRouter;
+    qint64 shedCount;
+
+    // Index under which request latency is recorded, assigned on first use
+    int metricsIndex();
+    int metricsHandler;
+
 private:
 
     QHttpHandler *const q;
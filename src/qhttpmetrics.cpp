@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QThreadStorage>
+
+#include <QHttpEngine/QHttpSocket>
+
+#include "qhttpmetrics_p.h"
+#include "qhttpresponses_p.h"
+
+const char *const MethodNames[MetricsMethodCount] = {
+    "OPTIONS", "GET", "HEAD", "POST", "PUT", "DELETE", "TRACE", "CONNECT", "UNKNOWN"
+};
+
+const qint64 BucketBounds[MetricsBucketCount - 1] = {
+    500000, 1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000, 1000000000, 2500000000LL, 5000000000LL
+};
+
+const char *const BucketNames[MetricsBucketCount] = {
+    "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05",
+    "0.1", "0.25", "0.5", "1", "2.5", "5", "+Inf"
+};
+
+const int MaxStatusCode = 600;
+
+// Shards are never freed so that the counts of threads that have exited
+// remain part of the totals
+class QHttpMetricsRegistry
+{
+public:
+
+    QHttpMetricsRegistry() {
+        timer.start();
+
+        // Assign an index to each registered status code, with the last one
+        // shared by all others
+        int next = 0;
+        for (int i = 0; i < MaxStatusCode; ++i) {
+            statusIndex[i] = MetricsStatusCount - 1;
+            if (!QHttpStatus::reason(i).isNull() && next < MetricsStatusCount - 1) {
+                statusCodes[next] = i;
+                statusIndex[i] = next++;
+            }
+        }
+        for (; next < MetricsStatusCount; ++next) {
+            statusCodes[next] = 0;
+        }
+
+        handlers.append("none");
+    }
+
+    QElapsedTimer timer;
+    int statusIndex[MaxStatusCode];
+    int statusCodes[MetricsStatusCount];
+
+    QMutex mutex;
+    QList<QHttpMetricsShard*> shards;
+    QStringList handlers;
+};
+
+Q_GLOBAL_STATIC(QHttpMetricsRegistry, registry)
+
+// QThreadStorage deletes its data when the thread exits, so it holds this
+// instead of the shard itself
+class QHttpMetricsShardRef
+{
+public:
+
+    QHttpMetricsShard *shard;
+};
+
+QHttpMetricsShard *QHttpMetrics::shard()
+{
+    static QThreadStorage<QHttpMetricsShardRef*> refs;
+    if (!refs.hasLocalData()) {
+        QHttpMetricsShardRef *ref = new QHttpMetricsShardRef;
+        ref->shard = new QHttpMetricsShard;
+
+        QMutexLocker locker(&registry()->mutex);
+        registry()->shards.append(ref->shard);
+        refs.setLocalData(ref);
+    }
+    return refs.localData()->shard;
+}
+
+qint64 QHttpMetrics::now()
+{
+    return registry()->timer.nsecsElapsed();
+}
+
+int QHttpMetrics::handlerIndex(const QString &name)
+{
+    QMutexLocker locker(&registry()->mutex);
+    QStringList &handlers = registry()->handlers;
+
+    int index = handlers.indexOf(name);
+    if (index == -1) {
+        if (handlers.count() == MetricsHandlerCount - 1) {
+            handlers.append("other");
+            return MetricsHandlerCount - 1;
+        } else if (handlers.count() == MetricsHandlerCount) {
+            return MetricsHandlerCount - 1;
+        }
+        handlers.append(name);
+        index = handlers.count() - 1;
+    }
+    return index;
+}
+
+void QHttpMetrics::recordRequest(QHttpMetricsShard *shard, int method, int statusCode,
+                                 int handler, qint64 nsecs)
+{
+    // Methods are single bits, which are converted to an index
+    int methodIndex = 0;
+    while (methodIndex < MetricsMethodCount - 1 && method != 1 << methodIndex) {
+        ++methodIndex;
+    }
+    int statusIndex = statusCode >= 0 && statusCode < MaxStatusCode ?
+            registry()->statusIndex[statusCode] : MetricsStatusCount - 1;
+
+    shard->requests[methodIndex][statusIndex].add(1);
+
+    int bucket = 0;
+    while (bucket < MetricsBucketCount - 1 && nsecs > BucketBounds[bucket]) {
+        ++bucket;
+    }
+    QHttpMetricsHistogram &histogram = shard->latency[handler];
+    histogram.buckets[bucket].add(1);
+    histogram.sum.add(nsecs);
+    histogram.count.add(1);
+}
+
+// Escape a label value as required by the exposition format
+static QByteArray escape(const QString &value)
+{
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return escaped;
+}
+
+static void appendHeader(QByteArray &data, const char *name, const char *type, const char *help)
+{
+    data.append("# HELP ").append(name).append(' ').append(help).append('\n');
+    data.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+}
+
+static void appendValue(QByteArray &data, const char *name, qint64 value)
+{
+    data.append(name).append(' ').append(QByteArray::number(value)).append('\n');
+}
+
+QByteArray QHttpMetrics::exposition()
+{
+    QHttpMetricsRegistry *r = registry();
+    QMutexLocker locker(&r->mutex);
+
+    // Sum the values from each of the shards
+    QHttpMetricsShard *total = new QHttpMetricsShard;
+    foreach (QHttpMetricsShard *s, r->shards) {
+        total->connectionsAccepted.add(s->connectionsAccepted.get());
+        total->connectionsShed.add(s->connectionsShed.get());
+        total->connectionsActive.add(s->connectionsActive.get());
+        total->bytesReceived.add(s->bytesReceived.get());
+        total->bytesSent.add(s->bytesSent.get());
+        for (int i = 0; i < MetricsMethodCount; ++i) {
+            for (int j = 0; j < MetricsStatusCount; ++j) {
+                total->requests[i][j].add(s->requests[i][j].get());
+            }
+        }
+        for (int i = 0; i < r->handlers.count(); ++i) {
+            for (int j = 0; j < MetricsBucketCount; ++j) {
+                total->latency[i].buckets[j].add(s->latency[i].buckets[j].get());
+            }
+            total->latency[i].sum.add(s->latency[i].sum.get());
+            total->latency[i].count.add(s->latency[i].count.get());
+        }
+    }
+
+    QByteArray data;
+
+    appendHeader(data, "qhttpengine_connections_accepted_total", "counter",
+                 "Connections accepted by the server.");
+    appendValue(data, "qhttpengine_connections_accepted_total", total->connectionsAccepted.get());
+    appendHeader(data, "qhttpengine_connections_shed_total", "counter",
+                 "Connections answered with a 503 error because the server was busy.");
+    appendValue(data, "qhttpengine_connections_shed_total", total->connectionsShed.get());
+    appendHeader(data, "qhttpengine_connections_active", "gauge",
+                 "Connections currently being served.");
+    appendValue(data, "qhttpengine_connections_active", total->connectionsActive.get());
+    appendHeader(data, "qhttpengine_received_bytes_total", "counter",
+                 "Bytes received from clients.");
+    appendValue(data, "qhttpengine_received_bytes_total", total->bytesReceived.get());
+    appendHeader(data, "qhttpengine_sent_bytes_total", "counter",
+                 "Bytes sent to clients.");
+    appendValue(data, "qhttpengine_sent_bytes_total", total->bytesSent.get());
+
+    appendHeader(data, "qhttpengine_requests_total", "counter",
+                 "Responses sent, by request method and status code.");
+    for (int i = 0; i < MetricsMethodCount; ++i) {
+        for (int j = 0; j < MetricsStatusCount; ++j) {
+            qint64 value = total->requests[i][j].get();
+            if (value) {
+                QByteArray code = j == MetricsStatusCount - 1 ?
+                        QByteArray("other") : QByteArray::number(r->statusCodes[j]);
+                data.append("qhttpengine_requests_total{method=\"").append(MethodNames[i])
+                        .append("\",code=\"").append(code).append("\"} ")
+                        .append(QByteArray::number(value)).append('\n');
+            }
+        }
+    }
+
+    appendHeader(data, "qhttpengine_request_duration_seconds", "histogram",
+                 "Time from receiving the request headers until the response was complete, by handler.");
+    for (int i = 0; i < r->handlers.count(); ++i) {
+        const QHttpMetricsHistogram &histogram = total->latency[i];
+        if (!histogram.count.get()) {
+            continue;
+        }
+        QByteArray handler = escape(r->handlers.at(i));
+        qint64 cumulative = 0;
+        for (int j = 0; j < MetricsBucketCount; ++j) {
+            cumulative += histogram.buckets[j].get();
+            data.append("qhttpengine_request_duration_seconds_bucket{handler=\"").append(handler)
+                    .append("\",le=\"").append(BucketNames[j]).append("\"} ")
+                    .append(QByteArray::number(cumulative)).append('\n');
+        }
+        data.append("qhttpengine_request_duration_seconds_sum{handler=\"").append(handler).append("\"} ")
+                .append(QByteArray::number(histogram.sum.get() / 1e9, 'g', 9)).append('\n');
+        data.append("qhttpengine_request_duration_seconds_count{handler=\"").append(handler).append("\"} ")
+                .append(QByteArray::number(histogram.count.get())).append('\n');
+    }
+
+    delete total;
+    return data;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QHTTPENGINE_QHTTPMETRICSPRIVATE_H
+#define QHTTPENGINE_QHTTPMETRICSPRIVATE_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QString>
+
+// Requests are counted by method (each of QHttpSocket::Method plus unknown)
+// and by status code (each registered code plus any other)
+const int MetricsMethodCount = 9;
+const int MetricsStatusCount = 72;
+
+// Latency is recorded for each handler up to this number, with the first
+// used for requests that were not routed through one and the last shared by
+// any handlers beyond it
+const int MetricsHandlerCount = 64;
+
+// Upper bounds of the latency buckets in nanoseconds, followed by +Inf
+const int MetricsBucketCount = 14;
+
+// Counter that is normally modified only by the thread that owns it - the
+// increment is still atomic since a socket moved to another thread keeps
+// recording into the shard it was created with, but being uncontended it
+// remains cheap
+class QHttpMetricsCounter
+{
+public:
+
+    QHttpMetricsCounter() : value(0) {}
+
+    void add(qint64 amount) { value.fetchAndAddRelaxed(amount); }
+    qint64 get() const { return value.load(); }
+
+private:
+
+    QAtomicInteger<qint64> value;
+};
+
+class QHttpMetricsHistogram
+{
+public:
+
+    QHttpMetricsCounter buckets[MetricsBucketCount];
+    QHttpMetricsCounter sum;
+    QHttpMetricsCounter count;
+};
+
+// Metrics recorded by a single thread - the padding keeps the counters of
+// different threads on separate cache lines
+class QHttpMetricsShard
+{
+public:
+
+    char leadingPadding[64];
+
+    QHttpMetricsCounter connectionsAccepted;
+    QHttpMetricsCounter connectionsShed;
+    QHttpMetricsCounter connectionsActive;
+    QHttpMetricsCounter bytesReceived;
+    QHttpMetricsCounter bytesSent;
+    QHttpMetricsCounter requests[MetricsMethodCount][MetricsStatusCount];
+    QHttpMetricsHistogram latency[MetricsHandlerCount];
+
+    char trailingPadding[64];
+};
+
+// Process-wide registry of metrics, which are summed over all of the
+// threads when exported
+class QHttpMetrics
+{
+public:
+
+    // Retrieve the shard for the current thread
+    static QHttpMetricsShard *shard();
+
+    // Monotonic time in nanoseconds
+    static qint64 now();
+
+    // Retrieve the index used for the handler with the specified name
+    static int handlerIndex(const QString &name);
+
+    static void recordRequest(QHttpMetricsShard *shard, int method, int statusCode,
+                              int handler, qint64 nsecs);
+
+    // Render all metrics in the Prometheus text format
+    static QByteArray exposition();
+};
+
+#endif // QHTTPENGINE_QHTTPMETRICSPRIVATE_H
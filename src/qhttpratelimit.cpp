@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <cmath>
+#include <cstring>
+
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QUuid>
+
+#include <QHttpEngine/QHttpRateLimit>
+#include <QHttpEngine/QHttpSocket>
+
+#include "qhttpratelimit_p.h"
+#include "qhttpsocket_p.h"
+
+// Number of buckets to search for the key before one is replaced
+const int MaxProbes = 8;
+
+const int DefaultCapacity = 65536;
+
+QHttpTokenTable::QHttpTokenTable()
+    : capacity(DefaultCapacity)
+{
+}
+
+void QHttpTokenTable::setCapacity(int capacity)
+{
+    this->capacity = 1;
+    while (this->capacity < capacity) {
+        this->capacity <<= 1;
+    }
+    buckets.clear();
+}
+
+QHttpTokenBucket *QHttpTokenTable::bucket(quint64 key, bool &created)
+{
+    // The table is only allocated once it is used
+    if (buckets.isEmpty()) {
+        buckets.resize(capacity);
+    }
+
+    // Buckets are never removed, so the key cannot be beyond an unused one
+    QHttpTokenBucket *data = buckets.data();
+    QHttpTokenBucket *victim = 0;
+    for (int i = 0; i < MaxProbes; ++i) {
+        QHttpTokenBucket *bucket = data + ((key + i) & (capacity - 1));
+        if (bucket->key == key) {
+            created = false;
+            return bucket;
+        }
+        if (!bucket->key) {
+            victim = bucket;
+            break;
+        }
+        if (!victim || bucket->time < victim->time) {
+            victim = bucket;
+        }
+    }
+
+    victim->key = key;
+    created = true;
+    return victim;
+}
+
+QHttpRateLimitRule::QHttpRateLimitRule()
+    : requestRate(0),
+      requestBurst(0),
+      byteRate(0),
+      byteBurst(0)
+{
+}
+
+bool QHttpRateLimitRule::isEnabled() const
+{
+    return requestRate > 0 || byteRate > 0;
+}
+
+void QHttpRateLimitRule::refill(QHttpTokenBucket *bucket, qint64 now) const
+{
+    double elapsed = (now - bucket->time) / 1000.0;
+    bucket->requests = qMin(requestBurst, bucket->requests + requestRate * elapsed);
+    bucket->bytes = qMin(byteBurst, bucket->bytes + byteRate * elapsed);
+    bucket->time = now;
+}
+
+double QHttpRateLimitRule::delay(const QHttpTokenBucket *bucket, qint64 size) const
+{
+    // Requests larger than the burst size are allowed once the bucket is full
+    double delay = 0;
+    if (requestRate > 0 && bucket->requests < 1) {
+        delay = (1 - bucket->requests) / requestRate;
+    }
+    if (byteRate > 0) {
+        double bytes = qMin(byteBurst, static_cast<double>(size));
+        if (bucket->bytes < bytes) {
+            delay = qMax(delay, (bytes - bucket->bytes) / byteRate);
+        }
+    }
+    return delay;
+}
+
+void QHttpRateLimitRule::consume(QHttpTokenBucket *bucket, qint64 size) const
+{
+    if (requestRate > 0) {
+        bucket->requests -= 1;
+    }
+    if (byteRate > 0) {
+        bucket->bytes -= qMin(byteBurst, static_cast<double>(size));
+    }
+}
+
+QHttpRateLimitPrivate::QHttpRateLimitPrivate(QHttpRateLimit *rateLimit)
+    : QObject(rateLimit),
+      apiKeyHeader("X-API-Key"),
+      limitedCount(0),
+      q(rateLimit)
+{
+    clock.start();
+
+    // Seed the hash so that clients cannot choose keys that collide - QUuid
+    // uses the system's source of randomness where one is available, and the
+    // halves are combined since each contains a few fixed version bits
+    QByteArray random = QUuid::createUuid().toRfc4122();
+    quint64 halves[2];
+    memcpy(halves, random.constData(), sizeof(halves));
+    seed = halves[0] ^ halves[1];
+}
+
+quint64 QHttpRateLimitPrivate::hash(const char *data, int size) const
+{
+    // 64-bit FNV-1a, with zero reserved for unused buckets
+    quint64 value = Q_UINT64_C(14695981039346656037) ^ seed;
+    for (int i = 0; i < size; ++i) {
+        value = (value ^ static_cast<uchar>(data[i])) * Q_UINT64_C(1099511628211);
+    }
+    return value ? value : 1;
+}
+
+QHttpRateLimit::QHttpRateLimit(QObject *parent)
+    : QHttpMiddleware(parent),
+      d(new QHttpRateLimitPrivate(this))
+{
+}
+
+void QHttpRateLimit::setRequestRate(Key key, double requestsPerSecond, int burst)
+{
+    d->rules[key].requestRate = requestsPerSecond;
+    d->rules[key].requestBurst = burst;
+}
+
+void QHttpRateLimit::setByteRate(Key key, qint64 bytesPerSecond, qint64 burst)
+{
+    d->rules[key].byteRate = bytesPerSecond;
+    d->rules[key].byteBurst = burst;
+}
+
+void QHttpRateLimit::setApiKeyHeader(const QByteArray &name)
+{
+    d->apiKeyHeader = name;
+}
+
+void QHttpRateLimit::setCapacity(int capacity)
+{
+    d->rules[ClientAddress].table.setCapacity(capacity);
+    d->rules[ApiKey].table.setCapacity(capacity);
+}
+
+qint64 QHttpRateLimit::limitedCount() const
+{
+    return d->limitedCount;
+}
+
+bool QHttpRateLimit::process(QHttpSocket *socket)
+{
+    QHttpSocketPrivate *socketPrivate = QHttpSocketPrivate::get(socket);
+    qint64 now = d->clock.elapsed();
+    qint64 size = socketPrivate->requestHeaderSize + qMax(Q_INT64_C(0), socket->contentLength());
+
+    // Find and refill the bucket for each enabled key, determining how long
+    // the client must wait before the request can be processed
+    QHttpTokenBucket *buckets[2] = {0, 0};
+    double delay = 0;
+    for (int i = 0; i < 2; ++i) {
+        const QHttpRateLimitRule &rule = d->rules[i];
+        if (!rule.isEnabled()) {
+            continue;
+        }
+
+        quint64 key;
+        if (i == ClientAddress) {
+            Q_IPV6ADDR address = socketPrivate->socket->peerAddress().toIPv6Address();
+            key = d->hash(reinterpret_cast<const char*>(address.c), sizeof(address.c));
+        } else {
+            QByteArray apiKey = socket->headers().value(d->apiKeyHeader);
+            if (apiKey.isEmpty()) {
+                continue;
+            }
+            key = d->hash(apiKey.constData(), apiKey.size());
+        }
+
+        // New buckets start out full
+        bool created;
+        buckets[i] = d->rules[i].table.bucket(key, created);
+        if (created) {
+            buckets[i]->requests = rule.requestBurst;
+            buckets[i]->bytes = rule.byteBurst;
+            buckets[i]->time = now;
+        } else {
+            rule.refill(buckets[i], now);
+        }
+
+        delay = qMax(delay, rule.delay(buckets[i], size));
+    }
+
+    if (delay > 0) {
+        ++d->limitedCount;
+        socket->setHeader("Retry-After", QByteArray::number(static_cast<int>(std::ceil(delay))));
+        socket->writeError(QHttpSocket::TooManyRequests);
+        return false;
+    }
+
+    // Tokens are only consumed once the request is allowed by every key
+    for (int i = 0; i < 2; ++i) {
+        if (buckets[i]) {
+            d->rules[i].consume(buckets[i], size);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef QHTTPENGINE_QHTTPRATELIMITPRIVATE_H
+#define QHTTPENGINE_QHTTPRATELIMITPRIVATE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVector>
+
+#include "QHttpEngine/qhttpratelimit.h"
+
+// Clients are identified by a 64-bit hash of their key rather than the key
+// itself, keeping each bucket small and of a fixed size - a key of zero
+// marks an unused bucket
+class QHttpTokenBucket
+{
+public:
+
+    QHttpTokenBucket() : key(0), time(0), requests(0), bytes(0) {}
+
+    quint64 key;
+    qint64 time;
+    double requests;
+    double bytes;
+};
+
+// Buckets are stored in an open-addressing table with linear probing that
+// never grows - if none of the buckets within reach of the hash are free,
+// the least recently used of them is replaced
+class QHttpTokenTable
+{
+public:
+
+    QHttpTokenTable();
+
+    void setCapacity(int capacity);
+    QHttpTokenBucket *bucket(quint64 key, bool &created);
+
+private:
+
+    int capacity;
+    QVector<QHttpTokenBucket> buckets;
+};
+
+class QHttpRateLimitRule
+{
+public:
+
+    QHttpRateLimitRule();
+
+    bool isEnabled() const;
+
+    void refill(QHttpTokenBucket *bucket, qint64 now) const;
+    double delay(const QHttpTokenBucket *bucket, qint64 size) const;
+    void consume(QHttpTokenBucket *bucket, qint64 size) const;
+
+    double requestRate;
+    double requestBurst;
+    double byteRate;
+    double byteBurst;
+
+    QHttpTokenTable table;
+};
+
+class QHttpRateLimitPrivate : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit QHttpRateLimitPrivate(QHttpRateLimit *rateLimit);
+
+    quint64 hash(const char *data, int size) const;
+
+    QHttpRateLimitRule rules[2];
+    QByteArray apiKeyHeader;
+    QElapsedTimer clock;
+    quint64 seed;
+    qint64 limitedCount;
+
+private:
+
+    QHttpRateLimit *const q;
+};
+
+#endif // QHTTPENGINE_QHTTPRATELIMITPRIVATE_H
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QHash>
+#include <QLocale>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadStorage>
+
+#include "qhttpengine_global.h"
+#include "qhttpresponses_p.h"
+
+// Predefined error response requires a simple HTML template to be returned to
+// the client describing the error condition
+const QString ErrorTemplate =
+        "<!DOCTYPE html>"
+        "<html>"
+          "<head>"
+            "<meta charset=\"utf-8\">"
+            "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
+            "<title>%1 %2</title>"
+          "</head>"
+          "<body>"
+            "<h1>%1 %2</h1>"
+            "<p>"
+              "An error has occurred while trying to display the requested resource. "
+              "Please contact the website owner if this error persists."
+            "</p>"
+            "<hr>"
+            "<p><em>QHttpEngine %3</em></p>"
+          "</body>"
+        "</html>";
+
+const struct {
+    int statusCode;
+    const char *reason;
+} StatusReasons[] = {
+    {100, "CONTINUE"},
+    {101, "SWITCHING PROTOCOLS"},
+    {102, "PROCESSING"},
+    {103, "EARLY HINTS"},
+    {200, "OK"},
+    {201, "CREATED"},
+    {202, "ACCEPTED"},
+    {203, "NON-AUTHORITATIVE INFORMATION"},
+    {204, "NO CONTENT"},
+    {205, "RESET CONTENT"},
+    {206, "PARTIAL CONTENT"},
+    {207, "MULTI-STATUS"},
+    {208, "ALREADY REPORTED"},
+    {226, "IM USED"},
+    {300, "MULTIPLE CHOICES"},
+    {301, "MOVED PERMANENTLY"},
+    {302, "FOUND"},
+    {303, "SEE OTHER"},
+    {304, "NOT MODIFIED"},
+    {305, "USE PROXY"},
+    {307, "TEMPORARY REDIRECT"},
+    {308, "PERMANENT REDIRECT"},
+    {400, "BAD REQUEST"},
+    {401, "UNAUTHORIZED"},
+    {402, "PAYMENT REQUIRED"},
+    {403, "FORBIDDEN"},
+    {404, "NOT FOUND"},
+    {405, "METHOD NOT ALLOWED"},
+    {406, "NOT ACCEPTABLE"},
+    {407, "PROXY AUTHENTICATION REQUIRED"},
+    {408, "REQUEST TIMEOUT"},
+    {409, "CONFLICT"},
+    {410, "GONE"},
+    {411, "LENGTH REQUIRED"},
+    {412, "PRECONDITION FAILED"},
+    {413, "PAYLOAD TOO LARGE"},
+    {414, "URI TOO LONG"},
+    {415, "UNSUPPORTED MEDIA TYPE"},
+    {416, "RANGE NOT SATISFIABLE"},
+    {417, "EXPECTATION FAILED"},
+    {421, "MISDIRECTED REQUEST"},
+    {422, "UNPROCESSABLE ENTITY"},
+    {423, "LOCKED"},
+    {424, "FAILED DEPENDENCY"},
+    {425, "TOO EARLY"},
+    {426, "UPGRADE REQUIRED"},
+    {428, "PRECONDITION REQUIRED"},
+    {429, "TOO MANY REQUESTS"},
+    {431, "REQUEST HEADER FIELDS TOO LARGE"},
+    {451, "UNAVAILABLE FOR LEGAL REASONS"},
+    {500, "INTERNAL SERVER ERROR"},
+    {501, "NOT IMPLEMENTED"},
+    {502, "BAD GATEWAY"},
+    {503, "SERVICE UNAVAILABLE"},
+    {504, "GATEWAY TIMEOUT"},
+    {505, "HTTP VERSION NOT SUPPORTED"},
+    {506, "VARIANT ALSO NEGOTIATES"},
+    {507, "INSUFFICIENT STORAGE"},
+    {508, "LOOP DETECTED"},
+    {510, "NOT EXTENDED"},
+    {511, "NETWORK AUTHENTICATION REQUIRED"}
+};
+
+const int MaxStatusCode = 600;
+
+// Index of reason phrases by status code, built once
+class QHttpStatusTable
+{
+public:
+
+    QHttpStatusTable() {
+        for (unsigned int i = 0; i < sizeof(StatusReasons) / sizeof(StatusReasons[0]); ++i) {
+            reasons[StatusReasons[i].statusCode] = QByteArray::fromRawData(
+                StatusReasons[i].reason, qstrlen(StatusReasons[i].reason)
+            );
+        }
+    }
+
+    QByteArray reasons[MaxStatusCode];
+};
+
+Q_GLOBAL_STATIC(QHttpStatusTable, statusTable)
+
+// The template is shared by all threads, with the generation indicating
+// when the responses built from it in each thread are stale
+class QHttpErrorTemplate
+{
+public:
+
+    QHttpErrorTemplate() : errorTemplate(ErrorTemplate) {}
+
+    QMutex mutex;
+    QString errorTemplate;
+    QAtomicInt generation;
+};
+
+Q_GLOBAL_STATIC(QHttpErrorTemplate, sharedTemplate)
+
+class QHttpErrorCache
+{
+public:
+
+    QHttpErrorCache() : generation(-1) {}
+
+    int generation;
+    QHash<int, QHttpResponse> responses;
+};
+
+class QHttpCommonHeadersCache
+{
+public:
+
+    QHttpCommonHeadersCache() : second(-1) {}
+
+    qint64 second;
+    QByteArray headers;
+};
+
+QByteArray QHttpCommonHeaders::current()
+{
+    static QThreadStorage<QHttpCommonHeadersCache*> caches;
+    if (!caches.hasLocalData()) {
+        caches.setLocalData(new QHttpCommonHeadersCache);
+    }
+    QHttpCommonHeadersCache *cache = caches.localData();
+
+    // The date uses the format from RFC 7231 (section 7.1.1.1), which must
+    // not be localized
+    qint64 second = QDateTime::currentMSecsSinceEpoch() / 1000;
+    if (cache->second != second) {
+        cache->second = second;
+        cache->headers = "Date: " + QLocale::c().toString(
+            QDateTime::fromMSecsSinceEpoch(second * 1000, Qt::UTC),
+            "ddd, dd MMM yyyy hh:mm:ss 'GMT'"
+        ).toLatin1() + "\r\n" + "Server: QHttpEngine/" QHTTPENGINE_VERSION "\r\n";
+    }
+    return cache->headers;
+}
+
+QByteArray QHttpStatus::reason(int statusCode)
+{
+    if (statusCode < 0 || statusCode >= MaxStatusCode) {
+        return QByteArray();
+    }
+    return statusTable()->reasons[statusCode];
+}
+
+const QHttpResponse *QHttpErrorResponses::response(int statusCode)
+{
+    QByteArray statusReason = QHttpStatus::reason(statusCode);
+    if (statusReason.isNull()) {
+        return 0;
+    }
+
+    static QThreadStorage<QHttpErrorCache*> caches;
+    if (!caches.hasLocalData()) {
+        caches.setLocalData(new QHttpErrorCache);
+    }
+    QHttpErrorCache *cache = caches.localData();
+
+    // Discard responses built from an old template
+    int generation = sharedTemplate()->generation.load();
+    if (cache->generation != generation) {
+        cache->responses.clear();
+        cache->generation = generation;
+    }
+
+    QHash<int, QHttpResponse>::const_iterator i = cache->responses.constFind(statusCode);
+    if (i == cache->responses.constEnd()) {
+        QByteArray data = body(statusCode, statusReason);
+
+        QHttpResponse response;
+        response.data = "HTTP/1.0 " + QByteArray::number(statusCode) + " " + statusReason + "\r\n";
+        response.statusLength = response.data.length();
+        response.data += "Content-Length: " + QByteArray::number(data.length()) + "\r\n" +
+                "Content-Type: text/html\r\n" +
+                "\r\n";
+        response.headerLength = response.data.length();
+        response.data.append(data);
+
+        i = cache->responses.insert(statusCode, response);
+    }
+    return &i.value();
+}
+
+QByteArray QHttpErrorResponses::body(int statusCode, const QByteArray &statusReason)
+{
+    QMutexLocker locker(&sharedTemplate()->mutex);
+    return sharedTemplate()->errorTemplate
+            .arg(statusCode)
+            .arg(QString::fromUtf8(statusReason))
+            .arg(QHTTPENGINE_VERSION)
+            .toUtf8();
+}
+
+void QHttpErrorResponses::setTemplate(const QString &errorTemplate)
+{
+    QMutexLocker locker(&sharedTemplate()->mutex);
+    sharedTemplate()->errorTemplate = errorTemplate.isNull() ? ErrorTemplate : errorTemplate;
+    sharedTemplate()->generation.ref();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef QHTTPENGINE_QHTTPRESPONSESPRIVATE_H
+#define QHTTPENGINE_QHTTPRESPONSESPRIVATE_H
+
+#include <QByteArray>
+#include <QString>
+
+// Reason phrases for every status code registered by RFC 7231 and the RFCs
+// that extend it - the returned arrays refer to static data, so obtaining
+// one does not allocate
+class QHttpStatus
+{
+public:
+
+    // Retrieve the reason phrase or a null array for unknown codes
+    static QByteArray reason(int statusCode);
+};
+
+// The Date and Server headers (in that order, each followed by a CRLF) added
+// to every response - they are formatted at most once per second for each
+// thread
+class QHttpCommonHeaders
+{
+public:
+
+    static QByteArray current();
+};
+
+// A complete response (status line, headers and body) that is never
+// modified - the common headers are inserted after the status line when it
+// is written
+class QHttpResponse
+{
+public:
+
+    QHttpResponse() : statusLength(0), headerLength(0) {}
+
+    QByteArray data;
+    int statusLength;
+    int headerLength;
+};
+
+// Error responses for each known status code are serialized from the
+// template the first time they are needed and kept for each thread (so that
+// no locking is needed to use them) until the template is changed
+class QHttpErrorResponses
+{
+public:
+
+    // Retrieve the response for a known status code or null
+    static const QHttpResponse *response(int statusCode);
+
+    // Render the body of an error for an arbitrary status
+    static QByteArray body(int statusCode, const QByteArray &statusReason);
+
+    static void setTemplate(const QString &errorTemplate);
+};
+
+#endif // QHTTPENGINE_QHTTPRESPONSESPRIVATE_H
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "qhttprouter_p.h"
+
+// Characters with special meaning in a regular expression
+const QString MetaCharacters = "^$.|?*+()[]{}";
+
+QHttpRouter::QHttpRouter()
+{
+    // The root node has an empty label and matches the empty path
+    nodes.append(Node());
+}
+
+int QHttpRouter::add(const QRegExp &pattern)
+{
+    Route route;
+    route.type = RegExp;
+    route.regExp = pattern;
+
+    QString literal;
+    bool exact;
+    bool isLiteral = literalPattern(pattern, literal, exact);
+    return addRoute(route, isLiteral, literal, exact);
+}
+
+int QHttpRouter::add(const QRegularExpression &pattern)
+{
+    Route route;
+    route.type = RegularExpression;
+    route.regularExpression = pattern;
+
+    QString literal;
+    bool exact;
+    bool isLiteral = literalPattern(pattern, literal, exact);
+
+    // Compile the pattern now (using the JIT where it is available) rather
+    // than when the first request arrives
+    if (!isLiteral) {
+        route.regularExpression.optimize();
+    }
+
+    return addRoute(route, isLiteral, literal, exact);
+}
+
+int QHttpRouter::match(const QString &path, int &matchedLength)
+{
+    int best = -1;
+    int bestLength = 0;
+
+    // Walk down the trie for as long as the labels match the path, keeping
+    // track of the earliest route that matches along the way
+    int current = 0;
+    int pos = 0;
+    while (true) {
+        const Node &node = nodes.at(current);
+
+        if (node.prefixRoute != -1 && (best == -1 || node.prefixRoute < best)) {
+            best = node.prefixRoute;
+            bestLength = pos;
+        }
+
+        if (pos == path.length()) {
+            if (node.exactRoute != -1 && (best == -1 || node.exactRoute < best)) {
+                best = node.exactRoute;
+                bestLength = pos;
+            }
+            break;
+        }
+
+        int child = findChild(node, path.at(pos));
+        if (child == -1) {
+            break;
+        }
+
+        const QString &label = nodes.at(child).label;
+        if (path.midRef(pos, label.length()) != label) {
+            break;
+        }
+
+        pos += label.length();
+        current = child;
+    }
+
+    // Regular expressions only need to be tested if they were added before
+    // the route found in the trie
+    foreach (int index, regExpRoutes) {
+        if (best != -1 && index > best) {
+            break;
+        }
+
+        Route &route = routes[index];
+        if (route.type == RegularExpression) {
+            regularExpressionMatch = route.regularExpression.match(path);
+            if (regularExpressionMatch.hasMatch()) {
+                best = index;
+                bestLength = regularExpressionMatch.capturedEnd();
+                break;
+            }
+        } else if (route.regExp.indexIn(path) != -1) {
+            best = index;
+            bestLength = route.regExp.matchedLength();
+            break;
+        }
+    }
+
+    matchedLength = bestLength;
+    return best;
+}
+
+QHttpRouter::Type QHttpRouter::type(int index) const
+{
+    return routes.at(index).type;
+}
+
+QRegExp &QHttpRouter::regExp(int index)
+{
+    return routes[index].regExp;
+}
+
+const QRegularExpressionMatch &QHttpRouter::lastMatch() const
+{
+    return regularExpressionMatch;
+}
+
+bool QHttpRouter::literalPattern(const QRegExp &pattern, QString &literal, bool &exact)
+{
+    // Only case-sensitive regular expressions can be matched by comparing
+    // prefixes - wildcards and fixed strings are not anchored
+    if (pattern.caseSensitivity() != Qt::CaseSensitive ||
+            (pattern.patternSyntax() != QRegExp::RegExp &&
+             pattern.patternSyntax() != QRegExp::RegExp2)) {
+        return false;
+    }
+
+    return literalPattern(pattern.pattern(), literal, exact);
+}
+
+bool QHttpRouter::literalPattern(const QRegularExpression &pattern, QString &literal, bool &exact)
+{
+    // Options such as case insensitivity or multiline anchors change the
+    // meaning of an otherwise literal pattern
+    if (pattern.patternOptions() != QRegularExpression::NoPatternOption) {
+        return false;
+    }
+
+    return literalPattern(pattern.pattern(), literal, exact);
+}
+
+bool QHttpRouter::literalPattern(const QString &source, QString &literal, bool &exact)
+{
+    // The pattern must be anchored to the beginning of the path
+    if (!source.startsWith('^')) {
+        return false;
+    }
+
+    literal.clear();
+    exact = false;
+
+    for (int i = 1; i < source.length(); ++i) {
+        QChar c = source.at(i);
+
+        // An escaped character is literal unless it is a class such as "\d"
+        // or a back-reference such as "\1"
+        if (c == '\\') {
+            if (++i == source.length() || source.at(i).isLetterOrNumber()) {
+                return false;
+            }
+            literal.append(source.at(i));
+        } else if (c == '$' && i == source.length() - 1) {
+            exact = true;
+        } else if (MetaCharacters.contains(c)) {
+            return false;
+        } else {
+            literal.append(c);
+        }
+    }
+
+    return true;
+}
+
+int QHttpRouter::addRoute(const Route &route, bool literal, const QString &literalPath, bool exact)
+{
+    int index = routes.count();
+    routes.append(route);
+
+    if (literal) {
+        routes[index].type = Literal;
+        insert(literalPath, exact, index);
+    } else {
+        regExpRoutes.append(index);
+    }
+
+    return index;
+}
+
+int QHttpRouter::findChild(const Node &node, QChar c) const
+{
+    // Children are kept sorted by the first character of their label
+    int low = 0;
+    int high = node.children.count() - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        QChar first = nodes.at(node.children.at(mid)).label.at(0);
+        if (first == c) {
+            return node.children.at(mid);
+        } else if (first < c) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+void QHttpRouter::insert(const QString &literal, bool exact, int index)
+{
+    int current = 0;
+    int pos = 0;
+
+    while (pos < literal.length()) {
+        int child = findChild(nodes.at(current), literal.at(pos));
+
+        // If no child begins with the next character, add the remainder of
+        // the literal as a new child, keeping the children sorted
+        if (child == -1) {
+            Node node;
+            node.label = literal.mid(pos);
+            nodes.append(node);
+            child = nodes.count() - 1;
+
+            QVector<int> &children = nodes[current].children;
+            int i = 0;
+            while (i < children.count() && nodes.at(children.at(i)).label.at(0) < literal.at(pos)) {
+                ++i;
+            }
+            children.insert(i, child);
+
+            current = child;
+            pos = literal.length();
+            break;
+        }
+
+        // Determine how much of the child's label is shared with the literal
+        const QString label = nodes.at(child).label;
+        int common = 0;
+        while (common < label.length() && pos + common < literal.length() &&
+                label.at(common) == literal.at(pos + common)) {
+            ++common;
+        }
+
+        // If only part of the label is shared, split the child in two so
+        // that the shared portion becomes a node of its own
+        if (common < label.length()) {
+            Node node;
+            node.label = label.left(common);
+            node.children.append(child);
+            nodes.append(node);
+            int split = nodes.count() - 1;
+
+            nodes[child].label = label.mid(common);
+
+            QVector<int> &children = nodes[current].children;
+            children[children.indexOf(child)] = split;
+
+            child = split;
+        }
+
+        current = child;
+        pos += common;
+    }
+
+    // Routes added earlier take precedence over later ones
+    Node &node = nodes[current];
+    int &route = exact ? node.exactRoute : node.prefixRoute;
+    if (route == -1) {
+        route = index;
+    }
+}
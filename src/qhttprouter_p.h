@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QHTTPENGINE_QHTTPROUTERPRIVATE_H
+#define QHTTPENGINE_QHTTPROUTERPRIVATE_H
+
+#include <QRegExp>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QString>
+#include <QVector>
+
+// Routes are matched against a path in the order they were added, with the
+// first match winning. Patterns that are anchored to the start of the path
+// and consist only of literal characters (for example "^api/" or "^$") are
+// compiled into a radix trie, which can be searched in a single pass over
+// the path without allocating. All other patterns are tested one after
+// another, but only if they were added before the best match in the trie.
+class QHttpRouter
+{
+public:
+
+    QHttpRouter();
+
+    enum Type {
+        Literal,
+        RegExp,
+        RegularExpression
+    };
+
+    // Add a route for the pattern, returning the index of the route
+    int add(const QRegExp &pattern);
+    int add(const QRegularExpression &pattern);
+
+    // Find the first matching route and return its index (or -1); the
+    // length of the matched portion of the path is stored in matchedLength
+    int match(const QString &path, int &matchedLength);
+
+    // Determine how the route is matched - for RegExp routes, the captured
+    // texts are available from the pattern and for RegularExpression routes
+    // they are available from lastMatch()
+    Type type(int index) const;
+    QRegExp &regExp(int index);
+    const QRegularExpressionMatch &lastMatch() const;
+
+    static bool literalPattern(const QRegExp &pattern, QString &literal, bool &exact);
+    static bool literalPattern(const QRegularExpression &pattern, QString &literal, bool &exact);
+
+private:
+
+    class Route
+    {
+    public:
+
+        Type type;
+        QRegExp regExp;
+        QRegularExpression regularExpression;
+    };
+
+    static bool literalPattern(const QString &source, QString &literal, bool &exact);
+    int addRoute(const Route &route, bool literal, const QString &literalPath, bool exact);
+
+    class Node
+    {
+    public:
+
+        Node() : exactRoute(-1), prefixRoute(-1) {}
+
+        QString label;
+        int exactRoute;
+        int prefixRoute;
+        QVector<int> children;
+    };
+
+    int findChild(const Node &node, QChar c) const;
+    void insert(const QString &literal, bool exact, int index);
+
+    QVector<Route> routes;
+    QVector<int> regExpRoutes;
+    QVector<Node> nodes;
+
+    QRegularExpressionMatch regularExpressionMatch;
+};
+
+#endif // QHTTPENGINE_QHTTPROUTERPRIVATE_H
@@ -21,34 +21,285 @@
  */
 
 #include <QTcpSocket>
+#include <QTimer>
+
+#if defined(Q_OS_UNIX)
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/socket.h>
+#endif
 
 #include <QHttpEngine/QHttpHandler>
 #include <QHttpEngine/QHttpSocket>
 
+#include "qhttpmetrics_p.h"
 #include "qhttpserver_p.h"
 
+// Clients must send the request headers within this time (in milliseconds)
+const int DefaultHeaderTimeout = 30000;
+
+// Clients are asked to retry shed requests after this time (in seconds)
+const int DefaultRetryAfter = 1;
+
+// Shed connections are closed after this time (in milliseconds) if the
+// client has not closed them
+const int ShedLingerTime = 2000;
+
 QHttpServerPrivate::QHttpServerPrivate(QHttpServer *httpServer)
     : QObject(httpServer),
       q(httpServer),
-      handler(0)
+      handler(0),
+      spillThreshold(DefaultSpillThreshold),
+      minimumRate(0),
+      maxConnections(-1),
+      softConnectionLimit(-1),
+      activeConnections(0),
+      acceptedConnections(0),
+      rejectedConnections(0),
+      paused(false)
 {
+    for (int i = 0; i < LimitCount; ++i) {
+        limits[i] = DefaultLimits[i];
+        rejected[i] = 0;
+    }
+    for (int i = 0; i < TimeoutCount; ++i) {
+        timeouts[i] = -1;
+    }
+    for (int i = 0; i < SocketOptionCount; ++i) {
+        socketOptions[i] = -1;
+    }
+    timeouts[QHttpSocket::HeaderTimeout] = DefaultHeaderTimeout;
+    setRetryAfter(DefaultRetryAfter);
+
     connect(q, &QHttpServer::newConnection, this, &QHttpServerPrivate::onIncomingConnection);
 }
 
+QHttpServerPrivate::~QHttpServerPrivate()
+{
+    // The sockets are destroyed after this object, so they must not report
+    // back to it
+    foreach (QHttpSocket *socket, findChildren<QHttpSocket*>()) {
+        QHttpSocketPrivate::get(socket)->observer = 0;
+    }
+}
+
+void QHttpServerPrivate::headersParsed(QHttpSocket *socket)
+{
+    if (handler) {
+        handler->route(socket, QString(socket->path().mid(1)));
+    } else {
+        socket->writeError(QHttpSocket::InternalServerError);
+    }
+}
+
+void QHttpServerPrivate::limitExceeded(QHttpSocket *, QHttpSocket::Limit limit)
+{
+    // Keep track of requests rejected for exceeding a limit
+    ++rejected[limit];
+}
+
+void QHttpServerPrivate::requestCompleted(QHttpSocket *socket)
+{
+    Q_EMIT q->requestCompleted(socket);
+}
+
+void QHttpServerPrivate::socketDestroyed(QHttpSocket *)
+{
+    // The connection is no longer active once the socket is destroyed
+    --activeConnections;
+    QHttpMetrics::shard()->connectionsActive.add(-1);
+    updateAccepting();
+}
+
+void QHttpServerPrivate::setRetryAfter(int seconds)
+{
+    // The response is built once so that shedding a connection costs no
+    // more than a single write
+    unavailableResponse = QByteArray("HTTP/1.0 503 SERVICE UNAVAILABLE\r\n") +
+            "Content-Length: 0\r\n" +
+            "Retry-After: " + QByteArray::number(seconds) + "\r\n\r\n";
+}
+
+// Stop sending on the socket once everything written has been sent, while
+// still allowing data to be received
+static void shutdownWrite(QTcpSocket *socket)
+{
+#if defined(Q_OS_UNIX)
+    if (socket->bytesToWrite()) {
+        return;
+    }
+    ::shutdown(socket->socketDescriptor(), SHUT_WR);
+#else
+    Q_UNUSED(socket)
+#endif
+}
+
+// Set an option directly on the descriptor for those not exposed by Qt -
+// failure is ignored since the options only affect performance
+static void setDescriptorOption(qintptr descriptor, int level, int name, int value)
+{
+#if defined(Q_OS_UNIX)
+    ::setsockopt(descriptor, level, name, &value, sizeof(value));
+#else
+    Q_UNUSED(descriptor)
+    Q_UNUSED(level)
+    Q_UNUSED(name)
+    Q_UNUSED(value)
+#endif
+}
+
+void QHttpServerPrivate::applyListenerOptions()
+{
+    qintptr descriptor = q->socketDescriptor();
+
+#if defined(Q_OS_UNIX)
+    // Calling listen() again on a listening socket updates the backlog
+    if (socketOptions[QHttpServer::ListenBacklog] >= 0) {
+        ::listen(descriptor, socketOptions[QHttpServer::ListenBacklog]);
+    }
+#endif
+#if defined(TCP_DEFER_ACCEPT)
+    if (socketOptions[QHttpServer::DeferAccept] >= 0) {
+        setDescriptorOption(descriptor, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                            socketOptions[QHttpServer::DeferAccept]);
+    }
+#endif
+#if defined(TCP_FASTOPEN)
+    if (socketOptions[QHttpServer::FastOpen] >= 0) {
+        setDescriptorOption(descriptor, IPPROTO_TCP, TCP_FASTOPEN,
+                            socketOptions[QHttpServer::FastOpen]);
+    }
+#endif
+
+    Q_UNUSED(descriptor)
+}
+
+void QHttpServerPrivate::applySocketOptions(QTcpSocket *socket)
+{
+    if (socketOptions[QHttpServer::NoDelay] >= 0) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption,
+                                socketOptions[QHttpServer::NoDelay] ? 1 : 0);
+    }
+    if (socketOptions[QHttpServer::SendBufferSize] >= 0) {
+        socket->setSocketOption(QAbstractSocket::SendBufferSizeSocketOption,
+                                socketOptions[QHttpServer::SendBufferSize]);
+    }
+    if (socketOptions[QHttpServer::ReceiveBufferSize] >= 0) {
+        socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption,
+                                socketOptions[QHttpServer::ReceiveBufferSize]);
+    }
+
+    // Keepalive is enabled if any of its parameters were set
+    if (socketOptions[QHttpServer::KeepAliveIdle] >= 0 ||
+            socketOptions[QHttpServer::KeepAliveInterval] >= 0 ||
+            socketOptions[QHttpServer::KeepAliveCount] >= 0) {
+        socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+    }
+
+    qintptr descriptor = socket->socketDescriptor();
+
+#if defined(TCP_NOTSENT_LOWAT)
+    if (socketOptions[QHttpServer::NotSentLowWatermark] >= 0) {
+        setDescriptorOption(descriptor, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                            socketOptions[QHttpServer::NotSentLowWatermark]);
+    }
+#endif
+#if defined(TCP_KEEPIDLE)
+    if (socketOptions[QHttpServer::KeepAliveIdle] >= 0) {
+        setDescriptorOption(descriptor, IPPROTO_TCP, TCP_KEEPIDLE,
+                            socketOptions[QHttpServer::KeepAliveIdle]);
+    }
+#elif defined(TCP_KEEPALIVE)
+    if (socketOptions[QHttpServer::KeepAliveIdle] >= 0) {
+        setDescriptorOption(descriptor, IPPROTO_TCP, TCP_KEEPALIVE,
+                            socketOptions[QHttpServer::KeepAliveIdle]);
+    }
+#endif
+#if defined(TCP_KEEPINTVL)
+    if (socketOptions[QHttpServer::KeepAliveInterval] >= 0) {
+        setDescriptorOption(descriptor, IPPROTO_TCP, TCP_KEEPINTVL,
+                            socketOptions[QHttpServer::KeepAliveInterval]);
+    }
+#endif
+#if defined(TCP_KEEPCNT)
+    if (socketOptions[QHttpServer::KeepAliveCount] >= 0) {
+        setDescriptorOption(descriptor, IPPROTO_TCP, TCP_KEEPCNT,
+                            socketOptions[QHttpServer::KeepAliveCount]);
+    }
+#endif
+
+    Q_UNUSED(descriptor)
+}
+
+void QHttpServerPrivate::updateAccepting()
+{
+    // Stop accepting connections when the maximum is reached, leaving new
+    // ones queued by the operating system until there is room for them
+    bool full = maxConnections >= 0 && activeConnections >= maxConnections;
+    if (full && !paused) {
+        q->pauseAccepting();
+        paused = true;
+    } else if (!full && paused) {
+        q->resumeAccepting();
+        paused = false;
+    }
+}
+
 void QHttpServerPrivate::onIncomingConnection()
 {
-    // Obtain the next pending connection and create a QHttpSocket from it
+    // Obtain the next pending connection
     QTcpSocket *tcpSocket = q->nextPendingConnection();
-    QHttpSocket *httpSocket = new QHttpSocket(tcpSocket, this);
+    applySocketOptions(tcpSocket);
+
+    // If over the soft limit, shed the connection without reading the request
+    if (softConnectionLimit >= 0 && activeConnections >= softConnectionLimit) {
+        ++rejectedConnections;
+        QHttpMetrics::shard()->connectionsShed.add(1);
+        connect(tcpSocket, &QTcpSocket::disconnected, tcpSocket, &QTcpSocket::deleteLater);
+
+        // Closing a socket with unread data resets the connection, which can
+        // discard the response before the client reads it - instead, the
+        // response is followed by a half-close and anything the client sends
+        // is discarded until it closes the connection or the linger time
+        // passes
+        connect(tcpSocket, &QTcpSocket::readyRead, tcpSocket, [tcpSocket]() {
+            char buffer[4096];
+            while (tcpSocket->read(buffer, sizeof(buffer)) > 0) {}
+        });
+        connect(tcpSocket, &QTcpSocket::bytesWritten, tcpSocket, [tcpSocket]() {
+            shutdownWrite(tcpSocket);
+        });
+        QTimer::singleShot(ShedLingerTime, tcpSocket, [tcpSocket]() {
+            tcpSocket->abort();
+            tcpSocket->deleteLater();
+        });
+
+        tcpSocket->write(unavailableResponse);
+        tcpSocket->flush();
+        shutdownWrite(tcpSocket);
+        return;
+    }
 
-    // Wait until the socket finishes reading the HTTP headers before routing
-    connect(httpSocket, &QHttpSocket::headersParsed, [this, httpSocket]() {
-        if (handler) {
-            handler->route(httpSocket, QString(httpSocket->path().mid(1)));
-        } else {
-            httpSocket->writeError(QHttpSocket::InternalServerError);
-        }
-    });
+    ++acceptedConnections;
+    ++activeConnections;
+
+    QHttpMetricsShard *metrics = QHttpMetrics::shard();
+    metrics->connectionsAccepted.add(1);
+    metrics->connectionsActive.add(1);
+    updateAccepting();
+
+    // Create a QHttpSocket from the connection, which reports its events
+    // directly to this object
+    QHttpSocket *httpSocket = new QHttpSocket(tcpSocket, this);
+    QHttpSocketPrivate::get(httpSocket)->observer = this;
+    httpSocket->setBodySpillThreshold(spillThreshold);
+    for (int i = 0; i < LimitCount; ++i) {
+        httpSocket->setLimit(static_cast<QHttpSocket::Limit>(i), limits[i]);
+    }
+    for (int i = 0; i < TimeoutCount; ++i) {
+        httpSocket->setTimeout(static_cast<QHttpSocket::Timeout>(i), timeouts[i]);
+    }
+    httpSocket->setMinimumTransferRate(minimumRate);
 
     // Destroy the socket once the client is disconnected
     connect(tcpSocket, &QTcpSocket::disconnected, httpSocket, &QHttpSocket::deleteLater);
@@ -71,3 +322,84 @@ void QHttpServer::setHandler(QHttpHandler *handler)
 {
     d->handler = handler;
 }
+
+bool QHttpServer::listen(const QHostAddress &address, quint16 port)
+{
+    if (!QTcpServer::listen(address, port)) {
+        return false;
+    }
+
+    d->applyListenerOptions();
+    return true;
+}
+
+void QHttpServer::setSocketOption(SocketOption option, int value)
+{
+    d->socketOptions[option] = value;
+
+    // Options for the listening socket are applied right away if it exists
+    if (option <= FastOpen && isListening()) {
+        d->applyListenerOptions();
+    }
+}
+
+int QHttpServer::socketOption(SocketOption option) const
+{
+    return d->socketOptions[option];
+}
+
+void QHttpServer::setBodySpillThreshold(qint64 size)
+{
+    d->spillThreshold = size;
+}
+
+void QHttpServer::setLimit(QHttpSocket::Limit limit, qint64 value)
+{
+    d->limits[limit] = value;
+}
+
+qint64 QHttpServer::rejectedCount(QHttpSocket::Limit limit) const
+{
+    return d->rejected[limit];
+}
+
+void QHttpServer::setTimeout(QHttpSocket::Timeout timeout, int msecs)
+{
+    d->timeouts[timeout] = msecs;
+}
+
+void QHttpServer::setMinimumTransferRate(qint64 bytesPerSecond)
+{
+    d->minimumRate = bytesPerSecond;
+}
+
+void QHttpServer::setMaxConnections(int count)
+{
+    d->maxConnections = count;
+    d->updateAccepting();
+}
+
+void QHttpServer::setSoftConnectionLimit(int count)
+{
+    d->softConnectionLimit = count;
+}
+
+void QHttpServer::setRetryAfter(int seconds)
+{
+    d->setRetryAfter(seconds);
+}
+
+int QHttpServer::activeConnections() const
+{
+    return d->activeConnections;
+}
+
+qint64 QHttpServer::acceptedConnections() const
+{
+    return d->acceptedConnections;
+}
+
+qint64 QHttpServer::rejectedConnections() const
+{
+    return d->rejectedConnections;
+}
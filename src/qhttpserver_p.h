@@ -23,21 +23,55 @@
 #ifndef QHTTPENGINE_QHTTPSERVERPRIVATE_H
 #define QHTTPENGINE_QHTTPSERVERPRIVATE_H
 
+#include <QByteArray>
 #include <QObject>
 
 #include <QHttpEngine/QHttpServer>
 
+#include "qhttpsocket_p.h"
+
 class QHttpHandler;
+class QTcpSocket;
+
+const int SocketOptionCount = QHttpServer::KeepAliveCount + 1;
 
-class QHttpServerPrivate : public QObject
+class QHttpServerPrivate : public QObject, public QHttpSocketObserver
 {
     Q_OBJECT
 
 public:
 
     explicit QHttpServerPrivate(QHttpServer *httpServer);
+    virtual ~QHttpServerPrivate();
+
+    virtual void headersParsed(QHttpSocket *socket);
+    virtual void limitExceeded(QHttpSocket *socket, QHttpSocket::Limit limit);
+    virtual void requestCompleted(QHttpSocket *socket);
+    virtual void socketDestroyed(QHttpSocket *socket);
 
     QHttpHandler *handler;
+    qint64 spillThreshold;
+    qint64 limits[LimitCount];
+    qint64 rejected[LimitCount];
+    int timeouts[TimeoutCount];
+    qint64 minimumRate;
+
+    int socketOptions[SocketOptionCount];
+
+    void setRetryAfter(int seconds);
+    void updateAccepting();
+    void applyListenerOptions();
+    void applySocketOptions(QTcpSocket *socket);
+
+    int maxConnections;
+    int softConnectionLimit;
+    int activeConnections;
+    qint64 acceptedConnections;
+    qint64 rejectedConnections;
+    bool paused;
+
+    // Response written to connections that are shed
+    QByteArray unavailableResponse;
 
 private Q_SLOTS:
 
@@ -25,43 +25,53 @@
 #include <QJsonDocument>
 #include <QJsonParseError>
 #include <QTcpSocket>
+#include <QTemporaryFile>
 
 #include <QHttpEngine/QHttpParser>
 
+#include "qhttpbufferpool_p.h"
+#include "qhttpmetrics_p.h"
+#include "qhttpresponses_p.h"
 #include "qhttpsocket_p.h"
 
-// Predefined error response requires a simple HTML template to be returned to
-// the client describing the error condition
-const QString ErrorTemplate =
-        "<!DOCTYPE html>"
-        "<html>"
-          "<head>"
-            "<meta charset=\"utf-8\">"
-            "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
-            "<title>%1 %2</title>"
-          "</head>"
-          "<body>"
-            "<h1>%1 %2</h1>"
-            "<p>"
-              "An error has occurred while trying to display the requested resource. "
-              "Please contact the website owner if this error persists."
-            "</p>"
-            "<hr>"
-            "<p><em>QHttpEngine %3</em></p>"
-          "</body>"
-        "</html>";
-
 QHttpSocketPrivate::QHttpSocketPrivate(QHttpSocket *httpSocket, QTcpSocket *tcpSocket)
     : QObject(httpSocket),
       q(httpSocket),
       socket(tcpSocket),
+      timerWheel(QHttpTimerWheel::instance()),
+      minimumRate(0),
+      rateActive(false),
+      bytesRead(0),
+      bytesWritten(0),
+      observer(0),
+      metrics(QHttpMetrics::shard()),
+      metricsHandler(0),
+      requestStart(-1),
+      outputBufferSize(DefaultOutputBufferSize),
+      flushPending(false),
+      spillThreshold(DefaultSpillThreshold),
+      spool(0),
       readState(ReadHeaders),
+      requestHeaderSize(0),
       requestDataRead(0),
       requestDataTotal(-1),
       writeState(WriteNone),
       responseStatusCode(200),
-      responseStatusReason(statusReason(200))
+      responseStatusReason(statusReason(200)),
+      responseHeaderSize(0)
 {
+    for (int i = 0; i < LimitCount; ++i) {
+        limits[i] = DefaultLimits[i];
+    }
+    for (int i = 0; i < TimeoutCount; ++i) {
+        timeouts[i] = -1;
+    }
+    for (int i = 0; i < PhaseCount; ++i) {
+        phases[i] = -1;
+    }
+    phases[QHttpSocket::AcceptedPhase] = QHttpMetrics::now();
+    startTime = headersTime = activityTime = timerWheel->now();
+
     socket->setParent(this);
 
     connect(socket, &QTcpSocket::readyRead, this, &QHttpSocketPrivate::onReadyRead);
@@ -71,33 +81,364 @@ QHttpSocketPrivate::QHttpSocketPrivate(QHttpSocket *httpSocket, QTcpSocket *tcpS
     onReadyRead();
 }
 
+QHttpSocketPrivate::~QHttpSocketPrivate()
+{
+    if (observer) {
+        observer->socketDestroyed(q);
+    }
+
+    QHttpBufferPool::release(readBuffer);
+    QHttpBufferPool::release(outputBuffer);
+}
+
 QByteArray QHttpSocketPrivate::statusReason(int statusCode) const
 {
-    switch (statusCode) {
-    case QHttpSocket::OK: return "OK";
-    case QHttpSocket::Created: return "CREATED";
-    case QHttpSocket::Accepted: return "ACCEPTED";
-    case QHttpSocket::PartialContent: return "PARTIAL CONTENT";
-    case QHttpSocket::MovedPermanently: return "MOVED PERMANENTLY";
-    case QHttpSocket::Found: return "FOUND";
-    case QHttpSocket::BadRequest: return "BAD REQUEST";
-    case QHttpSocket::Unauthorized: return "UNAUTHORIZED";
-    case QHttpSocket::Forbidden: return "FORBIDDEN";
-    case QHttpSocket::NotFound: return "NOT FOUND";
-    case QHttpSocket::MethodNotAllowed: return "METHOD NOT ALLOWED";
-    case QHttpSocket::Conflict: return "CONFLICT";
-    case QHttpSocket::BadGateway: return "BAD GATEWAY";
-    case QHttpSocket::ServiceUnavailable: return "SERVICE UNAVAILABLE";
-    case QHttpSocket::InternalServerError: return "INTERNAL SERVER ERROR";
-    case QHttpSocket::HttpVersionNotSupported: return "HTTP VERSION NOT SUPPORTED";
-    default: return "UNKNOWN ERROR";
+    QByteArray reason = QHttpStatus::reason(statusCode);
+    return reason.isNull() ? QByteArray("UNKNOWN ERROR") : reason;
+}
+
+bool QHttpSocketPrivate::writeResponse(const QHttpResponse &response)
+{
+    // The response can only be used if nothing was written and no headers
+    // were set, since they would be missing from it
+    if (writeState != WriteNone || !responseHeaders.isEmpty()) {
+        return false;
+    }
+
+    QByteArray commonHeaders = QHttpCommonHeaders::current();
+    const char *data = response.data.constData();
+
+    writeState = WriteHeaders;
+    responseHeaderSize = response.headerLength + commonHeaders.length();
+    responseHeaderRemaining = responseHeaderSize;
+    write(data, response.statusLength);
+    write(commonHeaders.constData(), commonHeaders.length());
+    write(data + response.statusLength, response.data.length() - response.statusLength);
+
+    // Begin measuring the rate at which the data is sent
+    if (minimumRate > 0 && !rateActive) {
+        updateTimer();
+    }
+
+    return true;
+}
+
+void QHttpSocketPrivate::writeHeaders()
+{
+    QByteArray commonHeaders = QHttpCommonHeaders::current();
+    int dateLength = commonHeaders.indexOf('\n') + 1;
+    bool hasDate = false;
+    bool hasServer = false;
+
+    // Determine the exact size of the header first so that it can be written
+    // to a single buffer - headers with the same name are adjacent in the map
+    // and are merged into a single line (except for Set-Cookie, which cannot
+    // be merged), with the values in the order they were set
+    int size = 9 + 4 + responseStatusReason.length() + 2 + 2;
+    for (auto i = responseHeaders.constBegin(); i != responseHeaders.constEnd();) {
+        const QIByteArray &name = i.key();
+        bool cookie = qstricmp(name.constData(), "Set-Cookie") == 0;
+        hasDate = hasDate || qstricmp(name.constData(), "Date") == 0;
+        hasServer = hasServer || qstricmp(name.constData(), "Server") == 0;
+
+        size += name.length() + 4;
+        for (bool first = true; i != responseHeaders.constEnd() &&
+                qstricmp(i.key().constData(), name.constData()) == 0; ++i, first = false) {
+            if (!first) {
+                size += cookie ? name.length() + 4 : 2;
+            }
+            size += i.value().length();
+        }
+    }
+    if (!hasDate) {
+        size += dateLength;
+    }
+    if (!hasServer) {
+        size += commonHeaders.length() - dateLength;
+    }
+
+    // Serialize directly to the end of the output buffer
+    QHttpBufferPool::acquire(outputBuffer);
+    int offset = outputBuffer.size();
+    outputBuffer.resize(offset + size);
+    char *p = outputBuffer.data() + offset;
+    auto append = [&p](const char *data, int length) {
+        memcpy(p, data, length);
+        p += length;
+    };
+
+    // Append the status line, the code is always three digits
+    int statusCode = qBound(100, responseStatusCode, 999);
+    append("HTTP/1.0 ", 9);
+    *p++ = '0' + statusCode / 100;
+    *p++ = '0' + statusCode / 10 % 10;
+    *p++ = '0' + statusCode % 10;
+    *p++ = ' ';
+    append(responseStatusReason.constData(), responseStatusReason.length());
+    append("\r\n", 2);
+
+    // Add the common headers unless they were set explicitly
+    if (!hasDate) {
+        append(commonHeaders.constData(), dateLength);
+    }
+    if (!hasServer) {
+        append(commonHeaders.constData() + dateLength, commonHeaders.length() - dateLength);
+    }
+
+    // Append each group of headers followed by a CRLF - values with the same
+    // name are stored most recent first, so each group is walked backwards
+    for (auto i = responseHeaders.constBegin(); i != responseHeaders.constEnd();) {
+        auto last = i;
+        while (last != responseHeaders.constEnd() &&
+                qstricmp(last.key().constData(), i.key().constData()) == 0) {
+            ++last;
+        }
+
+        const QIByteArray &name = (last - 1).key();
+        bool cookie = qstricmp(name.constData(), "Set-Cookie") == 0;
+
+        append(name.constData(), name.length());
+        append(": ", 2);
+        for (auto j = last; j != i;) {
+            --j;
+            append(j.value().constData(), j.value().length());
+            if (j != i) {
+                if (cookie) {
+                    append("\r\n", 2);
+                    append(name.constData(), name.length());
+                    append(": ", 2);
+                } else {
+                    append(", ", 2);
+                }
+            }
+        }
+        append("\r\n", 2);
+
+        i = last;
+    }
+
+    // Append an extra CRLF
+    append("\r\n", 2);
+
+    writeState = WriteHeaders;
+    responseHeaderSize = size;
+    responseHeaderRemaining = size;
+
+    scheduleFlush();
+}
+
+qint64 QHttpSocketPrivate::write(const char *data, qint64 len)
+{
+    // Data that would fill the buffer on its own is not copied into it
+    if (len && len >= outputBufferSize) {
+        if (!flushOutput()) {
+            return -1;
+        }
+        return socket->write(data, len);
+    }
+
+    if (len) {
+        QHttpBufferPool::acquire(outputBuffer);
+        outputBuffer.append(data, len);
+    }
+    return scheduleFlush() ? len : -1;
+}
+
+bool QHttpSocketPrivate::scheduleFlush()
+{
+    // Write the buffer once it is full - otherwise wait until control returns
+    // to the event loop so that further writes can be added to it
+    if (outputBuffer.size() >= outputBufferSize) {
+        return flushOutput();
+    } else if (!flushPending) {
+        flushPending = true;
+        QMetaObject::invokeMethod(this, "flushOutput", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+bool QHttpSocketPrivate::flushOutput()
+{
+    flushPending = false;
+
+    bool written = true;
+    if (!outputBuffer.isEmpty()) {
+        written = socket->write(outputBuffer.constData(), outputBuffer.size()) == outputBuffer.size();
+        QHttpBufferPool::release(outputBuffer);
+    }
+    return written;
+}
+
+qint64 QHttpSocketPrivate::pendingOutput() const
+{
+    return outputBuffer.size() + socket->bytesToWrite();
+}
+
+qint64 QHttpSocketPrivate::bufferedSize() const
+{
+    return readBuffer.size() + (spool ? spool->size() - spool->pos() : 0);
+}
+
+bool QHttpSocketPrivate::checkLimits(const qint64 *maxValues)
+{
+    const qint64 values[LimitCount] = {
+        requestHeaderSize,
+        requestHeaders.count(),
+        requestRawPath.length(),
+        requestDataTotal
+    };
+
+    for (int i = 0; i < LimitCount; ++i) {
+        if (maxValues[i] >= 0 && values[i] > maxValues[i]) {
+            reject(static_cast<QHttpSocket::Limit>(i));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void QHttpSocketPrivate::reject(QHttpSocket::Limit limit)
+{
+    // Discard anything received so far - writing the error closes the
+    // socket and ensures that nothing more is buffered
+    QHttpBufferPool::release(readBuffer);
+
+    if (observer) {
+        observer->limitExceeded(q, limit);
+    }
+    Q_EMIT q->limitExceeded(limit);
+
+    switch (limit) {
+    case QHttpSocket::MaxHeaderSize:
+    case QHttpSocket::MaxHeaderCount:
+        q->writeError(QHttpSocket::RequestHeaderFieldsTooLarge);
+        break;
+    case QHttpSocket::MaxUriLength:
+        q->writeError(QHttpSocket::UriTooLong);
+        break;
+    case QHttpSocket::MaxBodySize:
+        q->writeError(QHttpSocket::PayloadTooLarge);
+        break;
+    }
+}
+
+// Return the earlier of the deadline and the time the timeout expires,
+// where a negative value indicates no deadline or timeout
+static qint64 earlier(qint64 deadline, qint64 since, qint64 timeout)
+{
+    if (timeout < 0) {
+        return deadline;
     }
+    return deadline < 0 || since + timeout < deadline ? since + timeout : deadline;
+}
+
+// Determine whether the timeout (if any) has expired
+static bool expired(qint64 since, qint64 timeout, qint64 now)
+{
+    return timeout >= 0 && now >= since + timeout;
+}
+
+qint64 QHttpSocketPrivate::nextDeadline() const
+{
+    qint64 deadline = -1;
+    if (readState == ReadHeaders) {
+        deadline = earlier(deadline, startTime, timeouts[QHttpSocket::HeaderTimeout]);
+    }
+    if (readState == ReadData) {
+        deadline = earlier(deadline, headersTime, timeouts[QHttpSocket::BodyTimeout]);
+    }
+    if (writeState != WriteFinished) {
+        deadline = earlier(deadline, startTime, timeouts[QHttpSocket::TotalTimeout]);
+    }
+    deadline = earlier(deadline, activityTime, timeouts[QHttpSocket::IdleTimeout]);
+    if (rateActive) {
+        deadline = earlier(deadline, rateTime, RateInterval);
+    }
+    return deadline;
+}
+
+bool QHttpSocketPrivate::timedOut(qint64 now) const
+{
+    if ((readState == ReadHeaders && expired(startTime, timeouts[QHttpSocket::HeaderTimeout], now)) ||
+            (readState == ReadData && expired(headersTime, timeouts[QHttpSocket::BodyTimeout], now)) ||
+            (writeState != WriteFinished && expired(startTime, timeouts[QHttpSocket::TotalTimeout], now)) ||
+            expired(activityTime, timeouts[QHttpSocket::IdleTimeout], now)) {
+        return true;
+    }
+
+    // Check the number of bytes transferred in each direction once the
+    // interval is complete
+    if (rateActive && now >= rateTime + RateInterval) {
+        qint64 minimum = minimumRate * (now - rateTime) / 1000;
+        if ((readState != ReadFinished && bytesRead - rateBytesRead < minimum) ||
+                (pendingOutput() && bytesWritten - rateBytesWritten < minimum)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void QHttpSocketPrivate::updateTimer()
+{
+    // The transfer rate is measured while data is expected in either
+    // direction, starting a new interval each time the last one completes
+    bool transferring = minimumRate > 0 && (readState != ReadFinished || pendingOutput());
+    qint64 now = timerWheel->now();
+    if (transferring && (!rateActive || now >= rateTime + RateInterval)) {
+        rateTime = now;
+        rateBytesRead = bytesRead;
+        rateBytesWritten = bytesWritten;
+    }
+    rateActive = transferring;
+
+    // Nothing remains to be done once the response is written
+    qint64 deadline = nextDeadline();
+    if (deadline < 0 || (writeState == WriteFinished && !pendingOutput())) {
+        timerWheel->cancel(this);
+    } else {
+        timerWheel->schedule(this, deadline);
+    }
+}
+
+void QHttpSocketPrivate::expire()
+{
+    if (timedOut(timerWheel->now())) {
+
+        // If the response has not begun, let the client know why the
+        // connection is being closed, otherwise drop it immediately
+        if (writeState == WriteNone) {
+            q->writeError(QHttpSocket::RequestTimeout);
+        } else {
+            q->close();
+            socket->abort();
+        }
+    }
+
+    updateTimer();
 }
 
 void QHttpSocketPrivate::onReadyRead()
 {
-    // Append all of the new data to the read buffer
-    readBuffer.append(socket->readAll());
+    // Read all of the new data directly into the read buffer, which is only
+    // obtained once there is data to read
+    qint64 available = socket->bytesAvailable();
+    if (!available) {
+        return;
+    }
+    if (phases[QHttpSocket::FirstByteReceivedPhase] == -1) {
+        phases[QHttpSocket::FirstByteReceivedPhase] = QHttpMetrics::now();
+    }
+
+    QHttpBufferPool::acquire(readBuffer);
+    int offset = readBuffer.size();
+    readBuffer.resize(offset + static_cast<int>(available));
+    qint64 size = socket->read(readBuffer.data() + offset, available);
+    readBuffer.resize(offset + static_cast<int>(qMax(size, Q_INT64_C(0))));
+    bytesRead += readBuffer.size() - offset;
+    metrics->bytesReceived.add(readBuffer.size() - offset);
+    activityTime = timerWheel->now();
 
     // If reading headers, return if they could not be read (yet)
     if (readState == ReadHeaders && !readHeaders()) {
@@ -110,13 +451,22 @@ void QHttpSocketPrivate::onReadyRead()
         readData();
         break;
     case ReadFinished:
-        readBuffer.clear();
+        QHttpBufferPool::release(readBuffer);
         break;
     }
 }
 
 void QHttpSocketPrivate::onBytesWritten(qint64 bytes)
 {
+    bytesWritten += bytes;
+    metrics->bytesSent.add(bytes);
+    activityTime = timerWheel->now();
+
+    qint64 now = QHttpMetrics::now();
+    if (phases[QHttpSocket::FirstByteSentPhase] == -1) {
+        phases[QHttpSocket::FirstByteSentPhase] = now;
+    }
+
     // Check to see if all of the response header was written
     if (writeState == WriteHeaders) {
         if (responseHeaderRemaining - bytes > 0) {
@@ -131,17 +481,54 @@ void QHttpSocketPrivate::onBytesWritten(qint64 bytes)
     if (writeState == WriteData) {
         Q_EMIT q->bytesWritten(bytes);
     }
+
+    // The request is complete once the socket was closed and everything
+    // has been written
+    if (writeState == WriteFinished && !socket->bytesToWrite()) {
+        completeRequest(now);
+    }
+}
+
+void QHttpSocketPrivate::completeRequest(qint64 now)
+{
+    if (phases[QHttpSocket::LastByteSentPhase] != -1) {
+        return;
+    }
+    phases[QHttpSocket::LastByteSentPhase] = now;
+
+    if (observer) {
+        observer->requestCompleted(q);
+    }
+    Q_EMIT q->requestCompleted();
 }
 
 bool QHttpSocketPrivate::readHeaders()
 {
-    // Check for the double CRLF that signals the end of the headers and
-    // if it is not found, wait until the next time readyRead is emitted
+    // Check for the double CRLF that signals the end of the headers
     int index = readBuffer.indexOf("\r\n\r\n");
+
+    // If the headers are already too large, reject them without waiting for
+    // the rest to arrive (the last three bytes may be part of the CRLFs)
+    qint64 maxHeaderSize = limits[QHttpSocket::MaxHeaderSize];
+    if (maxHeaderSize >= 0 && (index == -1 ? readBuffer.size() - 3 : index) > maxHeaderSize) {
+        reject(QHttpSocket::MaxHeaderSize);
+        return false;
+    }
+
+    // If the end of the headers was not found, wait until the next time
+    // readyRead is emitted
     if (index == -1) {
         return false;
     }
 
+    // Count the headers before they are parsed into a map
+    qint64 maxHeaderCount = limits[QHttpSocket::MaxHeaderCount];
+    if (maxHeaderCount >= 0 &&
+            QByteArray::fromRawData(readBuffer.constData(), index).count("\r\n") > maxHeaderCount) {
+        reject(QHttpSocket::MaxHeaderCount);
+        return false;
+    }
+
     // Attempt to parse the headers and if a problem is encountered, abort
     // the connection (so that no more data is read or written) and return
     if (!QHttpParser::parseRequestHeaders(readBuffer.left(index), requestMethod, requestRawPath, requestHeaders) ||
@@ -150,25 +537,47 @@ bool QHttpSocketPrivate::readHeaders()
         return false;
     }
 
+    // Latency is measured from this point until the socket is closed
+    requestStart = QHttpMetrics::now();
+    phases[QHttpSocket::HeadersParsedPhase] = requestStart;
+
     // Remove the headers from the buffer
     readBuffer.remove(0, index + 4);
+    requestHeaderSize = index;
 
     // Check for the content-length header - if it is present, then
     // prepare to read the specified amount of data, otherwise, no data
     // should be read from the socket and the read channel is finished
     if (requestHeaders.contains("Content-Length")) {
+        bool ok;
+        requestDataTotal = requestHeaders.value("Content-Length").toLongLong(&ok);
+        if (!ok || requestDataTotal < 0) {
+            q->writeError(QHttpSocket::BadRequest);
+            return false;
+        }
         readState = ReadData;
-        requestDataTotal = requestHeaders.value("Content-Length").toLongLong();
     } else {
         readState = ReadFinished;
     }
 
+    // Ensure the URI and body are within the limits
+    if (!checkLimits(limits)) {
+        return false;
+    }
+
+    // The body deadline begins once the headers are received
+    headersTime = timerWheel->now();
+    updateTimer();
+
     // Indicate that the headers have been parsed
+    if (observer) {
+        observer->headersParsed(q);
+    }
     Q_EMIT q->headersParsed();
 
     // If the new readState is ReadFinished, then indicate so
     if (readState == ReadFinished) {
-        Q_EMIT q->readChannelFinished();
+        finishReading();
     }
 
     return true;
@@ -176,17 +585,66 @@ bool QHttpSocketPrivate::readHeaders()
 
 void QHttpSocketPrivate::readData()
 {
+    // If there is too much unread data to keep in memory, move it to the
+    // spool file and abort the request if that fails
+    if (!spill()) {
+        readState = ReadFinished;
+        QHttpBufferPool::release(readBuffer);
+        q->writeError(QHttpSocket::InternalServerError);
+        return;
+    }
+
     // Emit the readyRead() signal if any data is available in the buffer
-    if (readBuffer.size()) {
+    if (bufferedSize()) {
         Q_EMIT q->readyRead();
     }
 
     // Check to see if the specified amount of data has been read from the
     // socket, if so, emit the readChannelFinished() signal
-    if (requestDataRead + readBuffer.size() >= requestDataTotal) {
+    if (requestDataRead + bufferedSize() >= requestDataTotal) {
         readState = ReadFinished;
-        Q_EMIT q->readChannelFinished();
+        finishReading();
+    }
+}
+
+void QHttpSocketPrivate::finishReading()
+{
+    Q_EMIT q->readChannelFinished();
+
+    if (readFinished) {
+        std::function<void()> callback;
+        callback.swap(readFinished);
+        callback();
+    }
+}
+
+bool QHttpSocketPrivate::spill()
+{
+    // Create the spool file once the threshold is passed - if the file
+    // cannot be created, the data remains in memory
+    if (!spool && spillThreshold >= 0 && readBuffer.size() > spillThreshold) {
+        spool = new QTemporaryFile(this);
+        if (!spool->open()) {
+            delete spool;
+            spool = 0;
+            spillThreshold = -1;
+        }
     }
+
+    if (!spool || readBuffer.isEmpty()) {
+        return true;
+    }
+
+    // Append the data to the end of the file and return to the position
+    // that the next read will begin at
+    qint64 pos = spool->pos();
+    bool written = spool->seek(spool->size()) &&
+            spool->write(readBuffer) == readBuffer.size() &&
+            spool->flush() &&
+            spool->seek(pos);
+
+    QHttpBufferPool::release(readBuffer);
+    return written;
 }
 
 QHttpSocket::QHttpSocket(QTcpSocket *socket, QObject *parent)
@@ -200,7 +658,7 @@ QHttpSocket::QHttpSocket(QTcpSocket *socket, QObject *parent)
 qint64 QHttpSocket::bytesAvailable() const
 {
     if (d->readState > QHttpSocketPrivate::ReadHeaders) {
-        return d->readBuffer.size() + QIODevice::bytesAvailable();
+        return d->bufferedSize() + QIODevice::bytesAvailable();
     } else {
         return 0;
     }
@@ -213,13 +671,29 @@ bool QHttpSocket::isSequential() const
 
 void QHttpSocket::close()
 {
+    // Record the request once the response is complete
+    if (d->requestStart >= 0) {
+        QHttpMetrics::recordRequest(d->metrics, d->requestMethod, d->responseStatusCode,
+                                    d->metricsHandler, QHttpMetrics::now() - d->requestStart);
+        d->requestStart = -1;
+    }
+
     // Invoke the parent method
     QIODevice::close();
 
     d->readState = QHttpSocketPrivate::ReadFinished;
     d->writeState = QHttpSocketPrivate::WriteFinished;
 
+    // Anything remaining in the output buffer must reach the socket before
+    // it is closed
+    d->flushOutput();
+    bool written = !d->socket->bytesToWrite();
     d->socket->close();
+
+    // Otherwise the request is completed once the data is written
+    if (written) {
+        d->completeRequest(QHttpMetrics::now());
+    }
 }
 
 bool QHttpSocket::isHeadersParsed() const
@@ -257,10 +731,74 @@ qint64 QHttpSocket::contentLength() const
     return d->requestDataTotal;
 }
 
+void QHttpSocket::setLimit(Limit limit, qint64 value)
+{
+    d->limits[limit] = value;
+}
+
+qint64 QHttpSocket::limit(Limit limit) const
+{
+    return d->limits[limit];
+}
+
+void QHttpSocket::setTimeout(Timeout timeout, int msecs)
+{
+    d->timeouts[timeout] = msecs;
+    d->updateTimer();
+}
+
+int QHttpSocket::timeout(Timeout timeout) const
+{
+    return d->timeouts[timeout];
+}
+
+void QHttpSocket::setMinimumTransferRate(qint64 bytesPerSecond)
+{
+    d->minimumRate = bytesPerSecond;
+    d->updateTimer();
+}
+
+void QHttpSocket::setBodySpillThreshold(qint64 size)
+{
+    d->spillThreshold = size;
+}
+
+qint64 QHttpSocket::phaseTime(Phase phase) const
+{
+    return d->phases[phase];
+}
+
+QString QHttpSocket::bodyFileName() const
+{
+    return d->spool ? d->spool->fileName() : QString();
+}
+
 bool QHttpSocket::readJson(QJsonDocument &document)
 {
     QJsonParseError error;
-    document = QJsonDocument::fromJson(readAll(), &error);
+
+    // If none of the data has been read into the QIODevice buffer, parse it
+    // where it is stored instead of copying it with readAll()
+    if (QIODevice::bytesAvailable()) {
+        document = QJsonDocument::fromJson(readAll(), &error);
+    } else if (d->spool) {
+        qint64 size = d->spool->size() - d->spool->pos();
+        uchar *data = size ? d->spool->map(d->spool->pos(), size) : 0;
+        if (data) {
+            document = QJsonDocument::fromJson(
+                QByteArray::fromRawData(reinterpret_cast<const char*>(data), size), &error
+            );
+            d->spool->unmap(data);
+            d->spool->seek(d->spool->size());
+            d->requestDataRead += size;
+        } else {
+            document = QJsonDocument::fromJson(readAll(), &error);
+        }
+    } else {
+        document = QJsonDocument::fromJson(d->readBuffer, &error);
+        d->requestDataRead += d->readBuffer.size();
+        QHttpBufferPool::release(d->readBuffer);
+    }
 
     if (error.error != QJsonParseError::NoError) {
         writeError(QHttpSocket::BadRequest);
@@ -278,10 +816,11 @@ void QHttpSocket::setStatusCode(int statusCode, const QByteArray &statusReason)
 
 void QHttpSocket::setHeader(const QByteArray &name, const QByteArray &value, bool replace)
 {
-    if (replace || d->responseHeaders.count(name)) {
+    // Values are kept separate so that Set-Cookie headers are not merged
+    if (replace) {
         d->responseHeaders.replace(name, value);
     } else {
-        d->responseHeaders.replace(name, d->responseHeaders.value(name) + ", " + value);
+        d->responseHeaders.insert(name, value);
     }
 }
 
@@ -290,33 +829,19 @@ void QHttpSocket::setHeaders(const HeaderMap &headers)
     d->responseHeaders = headers;
 }
 
-void QHttpSocket::writeHeaders()
+void QHttpSocket::setOutputBufferSize(qint64 size)
 {
-    // Use a QByteArray for building the header so that we can later determine
-    // exactly how many bytes were written
-    QByteArray header;
-
-    // Append the status line
-    header.append("HTTP/1.0 ");
-    header.append(QByteArray::number(d->responseStatusCode) + " " + d->responseStatusReason);
-    header.append("\r\n");
-
-    // Append each of the headers followed by a CRLF
-    for (auto i = d->responseHeaders.constBegin(); i != d->responseHeaders.constEnd(); ++i) {
-        header.append(i.key());
-        header.append(": ");
-        header.append(d->responseHeaders.values(i.key()).join(", "));
-        header.append("\r\n");
-    }
-
-    // Append an extra CRLF
-    header.append("\r\n");
+    d->outputBufferSize = size;
+}
 
-    d->writeState = QHttpSocketPrivate::WriteHeaders;
-    d->responseHeaderRemaining = header.length();
+void QHttpSocket::flush()
+{
+    d->flushOutput();
+}
 
-    // Write the header
-    d->socket->write(header);
+void QHttpSocket::writeHeaders()
+{
+    d->writeHeaders();
 }
 
 void QHttpSocket::writeRedirect(const QByteArray &path, bool permanent)
@@ -331,21 +856,31 @@ void QHttpSocket::writeError(int statusCode, const QByteArray &statusReason)
 {
     setStatusCode(statusCode, statusReason);
 
+    // Errors with the standard reason are written from a prebuilt response
+    // whenever possible
+    if (statusReason.isNull()) {
+        const QHttpResponse *response = QHttpErrorResponses::response(statusCode);
+        if (response && d->writeResponse(*response)) {
+            close();
+            return;
+        }
+    }
+
     // Build the template that will be sent to the client
-    QByteArray data = ErrorTemplate
-            .arg(d->responseStatusCode)
-            .arg(d->responseStatusReason.constData())
-            .arg(QHTTPENGINE_VERSION)
-            .toUtf8();
+    QByteArray data = QHttpErrorResponses::body(d->responseStatusCode, d->responseStatusReason);
 
     setHeader("Content-Length", QByteArray::number(data.length()));
     setHeader("Content-Type", "text/html");
 
-    writeHeaders();
     write(data);
     close();
 }
 
+void QHttpSocket::setErrorTemplate(const QString &errorTemplate)
+{
+    QHttpErrorResponses::setTemplate(errorTemplate);
+}
+
 void QHttpSocket::writeJson(const QJsonDocument &document, int statusCode)
 {
     QByteArray data = document.toJson();
@@ -363,12 +898,24 @@ qint64 QHttpSocket::readData(char *data, qint64 maxlen)
         return 0;
     }
 
+    // Once data is spooled, all of it is read from the file
+    if (d->spool) {
+        qint64 size = d->spool->read(data, maxlen);
+        if (size > 0) {
+            d->requestDataRead += size;
+        }
+        return size;
+    }
+
     // Ensure that no more than the requested amount or the size of the buffer is read
     qint64 size = qMin(static_cast<qint64>(d->readBuffer.size()), maxlen);
     memcpy(data, d->readBuffer.constData(), size);
 
     // Remove the amount that was read from the buffer
     d->readBuffer.remove(0, size);
+    if (d->readBuffer.isEmpty()) {
+        QHttpBufferPool::release(d->readBuffer);
+    }
     d->requestDataRead += size;
 
     return size;
@@ -377,10 +924,18 @@ qint64 QHttpSocket::readData(char *data, qint64 maxlen)
 qint64 QHttpSocket::writeData(const char *data, qint64 len)
 {
     // If the response headers have not yet been written, they must
-    // immediately be written before the data can be
+    // immediately be written before the data can be - both end up in the
+    // output buffer and leave together
     if (d->writeState == QHttpSocketPrivate::WriteNone) {
-        writeHeaders();
+        d->writeHeaders();
+    }
+
+    qint64 written = d->write(data, len);
+
+    // Begin measuring the rate at which the data is sent
+    if (d->minimumRate > 0 && !d->rateActive) {
+        d->updateTimer();
     }
 
-    return d->socket->write(data, len);
+    return written;
 }
@@ -23,23 +23,146 @@
 #ifndef QHTTPENGINE_QHTTPSOCKETPRIVATE_H
 #define QHTTPENGINE_QHTTPSOCKETPRIVATE_H
 
+#include <functional>
+
 #include <QHttpEngine/QHttpSocket>
 
+#include "qhttptimerwheel_p.h"
+
+class QHttpMetricsShard;
+class QHttpResponse;
+
 class QTcpSocket;
+class QTemporaryFile;
+
+// Default value for the spill threshold (in bytes)
+const qint64 DefaultSpillThreshold = 1024 * 1024;
+
+// Limits are stored in arrays indexed by QHttpSocket::Limit, where a negative
+// value indicates that there is no limit
+const int LimitCount = QHttpSocket::MaxBodySize + 1;
+const qint64 DefaultLimits[LimitCount] = {
+    64 * 1024,
+    100,
+    8 * 1024,
+    -1
+};
+
+// Deadlines are stored in arrays indexed by QHttpSocket::Timeout, where a
+// negative value indicates that there is no deadline
+const int TimeoutCount = QHttpSocket::TotalTimeout + 1;
+
+// Times are kept for each QHttpSocket::Phase
+const int PhaseCount = QHttpSocket::LastByteSentPhase + 1;
+
+// Interval (in milliseconds) over which the transfer rate is measured
+const int RateInterval = 5000;
+
+// Default size (in bytes) of the output buffer
+const qint64 DefaultOutputBufferSize = 16 * 1024;
+
+// Receives events from the sockets it is attached to through direct calls,
+// which avoids the cost of signal emission on the path of each request -
+// the signals are still emitted for everyone else
+class QHttpSocketObserver
+{
+public:
+
+    virtual ~QHttpSocketObserver() {}
+
+    virtual void headersParsed(QHttpSocket *socket) = 0;
+    virtual void limitExceeded(QHttpSocket *socket, QHttpSocket::Limit limit) = 0;
+    virtual void requestCompleted(QHttpSocket *socket) = 0;
+    virtual void socketDestroyed(QHttpSocket *socket) = 0;
+};
 
-class QHttpSocketPrivate : public QObject
+class QHttpSocketPrivate : public QObject, public QHttpTimerWheel::Entry
 {
     Q_OBJECT
 
 public:
 
     QHttpSocketPrivate(QHttpSocket *httpSocket, QTcpSocket *tcpSocket);
+    virtual ~QHttpSocketPrivate();
+
+    static QHttpSocketPrivate *get(QHttpSocket *socket) { return socket->d; }
 
     QByteArray statusReason(int statusCode) const;
 
+    // Write a complete response, returning false if it cannot be used
+    bool writeResponse(const QHttpResponse &response);
+
+    // Serialize the response headers to the output buffer
+    void writeHeaders();
+
+    // Add data to the output buffer, writing it once full - -1 is returned
+    // if the data could not be written
+    qint64 write(const char *data, qint64 len);
+    bool scheduleFlush();
+
+    // Number of bytes of the response not yet written to the operating system
+    qint64 pendingOutput() const;
+
+    // Record the end of the request and report it
+    void completeRequest(qint64 now);
+
+    qint64 bufferedSize() const;
+
+    bool checkLimits(const qint64 *maxValues);
+    void reject(QHttpSocket::Limit limit);
+
+    qint64 limits[LimitCount];
+
+    void updateTimer();
+    virtual void expire();
+
+    // Times are in milliseconds from the clock of the timer wheel, which
+    // is not restarted whenever data is transferred - the deadlines are
+    // only checked once the wheel expires the socket
+    QHttpTimerWheel *timerWheel;
+    int timeouts[TimeoutCount];
+    qint64 startTime;
+    qint64 headersTime;
+    qint64 activityTime;
+
+    qint64 minimumRate;
+    bool rateActive;
+    qint64 rateTime;
+    qint64 rateBytesRead;
+    qint64 rateBytesWritten;
+
+    qint64 bytesRead;
+    qint64 bytesWritten;
+
+    QHttpSocketObserver *observer;
+
+    // Metrics are recorded in the shard for the thread that created the
+    // socket, attributing the request to the last handler that routed it
+    QHttpMetricsShard *metrics;
+    int metricsHandler;
+    qint64 requestStart;
+
+    // Time at which each phase was reached or -1
+    qint64 phases[PhaseCount];
+
+    // Invoked once (after the readChannelFinished() signal) when all of the
+    // request data has been received
+    std::function<void()> readFinished;
+
     QTcpSocket *socket;
     QByteArray readBuffer;
 
+    // Response data is collected in the output buffer and written to the
+    // socket when the buffer is full or control returns to the event loop
+    qint64 outputBufferSize;
+    QByteArray outputBuffer;
+    bool flushPending;
+
+    // Unread request data is moved to the spool file once there is more of
+    // it than the threshold allows
+    qint64 spillThreshold;
+    QTemporaryFile *spool;
+
     enum {
         ReadHeaders,
         ReadData,
@@ -51,6 +174,7 @@ public:
     QString requestPath;
     QHttpSocket::QueryStringMap requestQueryString;
     QHttpSocket::HeaderMap requestHeaders;
+    int requestHeaderSize;
     qint64 requestDataRead;
     qint64 requestDataTotal;
 
@@ -64,8 +188,13 @@ public:
     int responseStatusCode;
     QByteArray responseStatusReason;
     QHttpSocket::HeaderMap responseHeaders;
+    qint64 responseHeaderSize;
     qint64 responseHeaderRemaining;
 
+public Q_SLOTS:
+
+    bool flushOutput();
+
 private Q_SLOTS:
 
     void onReadyRead();
@@ -75,6 +204,11 @@ private:
 
     bool readHeaders();
     void readData();
+    void finishReading();
+    bool spill();
+
+    qint64 nextDeadline() const;
+    bool timedOut(qint64 now) const;
 
     QHttpSocket *const q;
 };
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <QThreadStorage>
+#include <QTimerEvent>
+
+#include "qhttptimerwheel_p.h"
+
+// Resolution and size of the wheel shared by connections in each thread,
+// which covers a little over a minute before entries wrap around
+const int DefaultResolution = 128;
+const int DefaultBucketCount = 512;
+
+QHttpTimerWheel::Entry::~Entry()
+{
+    if (wheel) {
+        wheel->cancel(this);
+    }
+}
+
+QHttpTimerWheel::QHttpTimerWheel(int resolution, int bucketCount, QObject *parent)
+    : QObject(parent),
+      resolution(resolution),
+      buckets(bucketCount),
+      currentTick(0),
+      timerId(0),
+      entryCount(0)
+{
+    // Each bucket is the head of a circular list
+    for (int i = 0; i < buckets.count(); ++i) {
+        buckets[i].prev = buckets[i].next = &buckets[i];
+    }
+
+    clock.start();
+}
+
+QHttpTimerWheel::~QHttpTimerWheel()
+{
+    // Detach any remaining entries so they do not refer to the wheel
+    for (int i = 0; i < buckets.count(); ++i) {
+        while (buckets[i].next != &buckets[i]) {
+            Entry *entry = static_cast<Entry*>(buckets[i].next);
+            unlink(entry);
+            entry->wheel = 0;
+        }
+    }
+}
+
+QHttpTimerWheel *QHttpTimerWheel::instance()
+{
+    static QThreadStorage<QHttpTimerWheel*> wheels;
+    if (!wheels.hasLocalData()) {
+        wheels.setLocalData(new QHttpTimerWheel(DefaultResolution, DefaultBucketCount));
+    }
+    return wheels.localData();
+}
+
+qint64 QHttpTimerWheel::now() const
+{
+    return clock.elapsed();
+}
+
+void QHttpTimerWheel::schedule(Entry *entry, qint64 deadline)
+{
+    if (entry->wheel) {
+        unlink(entry);
+    } else {
+        entry->wheel = this;
+        ++entryCount;
+    }
+
+    // Start the timer when the first entry is added, synchronizing the
+    // current tick with the clock since nothing was scheduled until now
+    if (!timerId) {
+        currentTick = now() / resolution;
+        timerId = startTimer(resolution);
+    }
+
+    // The entry must never be placed in a bucket that was already processed
+    entry->tick = qMax((deadline + resolution - 1) / resolution, currentTick + 1);
+    link(&buckets[entry->tick % buckets.count()], entry);
+}
+
+void QHttpTimerWheel::cancel(Entry *entry)
+{
+    if (entry->wheel) {
+        unlink(entry);
+        entry->wheel = 0;
+        --entryCount;
+    }
+}
+
+int QHttpTimerWheel::count() const
+{
+    return entryCount;
+}
+
+void QHttpTimerWheel::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != timerId) {
+        QObject::timerEvent(event);
+        return;
+    }
+
+    // Process each tick that has elapsed - more than one if the event loop
+    // was busy when the timer should have fired
+    qint64 targetTick = now() / resolution;
+    while (currentTick < targetTick && entryCount) {
+        ++currentTick;
+
+        // Move the contents of the bucket to a separate list so that entries
+        // can safely be rescheduled or cancelled while expiring others
+        Link *bucket = &buckets[currentTick % buckets.count()];
+        if (bucket->next == bucket) {
+            continue;
+        }
+        Link pending;
+        pending.prev = bucket->prev;
+        pending.next = bucket->next;
+        pending.prev->next = pending.next->prev = &pending;
+        bucket->prev = bucket->next = bucket;
+
+        while (pending.next != &pending) {
+            Entry *entry = static_cast<Entry*>(pending.next);
+            unlink(entry);
+
+            // Entries further than one revolution away remain in the bucket
+            if (entry->tick > currentTick) {
+                link(bucket, entry);
+                continue;
+            }
+
+            entry->wheel = 0;
+            --entryCount;
+            entry->expire();
+        }
+    }
+
+    // Stop the timer once there is nothing left to expire
+    if (!entryCount) {
+        killTimer(timerId);
+        timerId = 0;
+    }
+}
+
+void QHttpTimerWheel::link(Link *list, Link *link)
+{
+    link->prev = list->prev;
+    link->next = list;
+    list->prev->next = link;
+    list->prev = link;
+}
+
+void QHttpTimerWheel::unlink(Link *link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->prev = link->next = 0;
+}
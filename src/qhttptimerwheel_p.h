@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef QHTTPENGINE_QHTTPTIMERWHEELPRIVATE_H
+#define QHTTPENGINE_QHTTPTIMERWHEELPRIVATE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVector>
+
+// Deadlines for all connections in a thread are kept in a single hashed
+// timer wheel instead of a QTimer for each connection. Each bucket of the
+// wheel holds an intrusive list of the entries that expire on a tick
+// mapping to it, so scheduling and cancelling an entry is O(1) and only a
+// single timer is running - and only while there is something scheduled.
+class QHttpTimerWheel : public QObject
+{
+public:
+
+    class Link
+    {
+    public:
+
+        Link() : prev(0), next(0) {}
+
+        Link *prev;
+        Link *next;
+    };
+
+    class Entry : public Link
+    {
+    public:
+
+        Entry() : wheel(0), tick(0) {}
+        virtual ~Entry();
+
+        // Invoked once the deadline passes - the entry is no longer scheduled
+        virtual void expire() = 0;
+
+    private:
+
+        friend class QHttpTimerWheel;
+
+        QHttpTimerWheel *wheel;
+        qint64 tick;
+    };
+
+    QHttpTimerWheel(int resolution, int bucketCount, QObject *parent = 0);
+    virtual ~QHttpTimerWheel();
+
+    // Obtain the wheel shared by all connections in the current thread
+    static QHttpTimerWheel *instance();
+
+    // Milliseconds elapsed on the monotonic clock used for deadlines
+    qint64 now() const;
+
+    // Schedule the entry to expire at the specified time (replacing any
+    // existing deadline) or cancel it
+    void schedule(Entry *entry, qint64 deadline);
+    void cancel(Entry *entry);
+
+    int count() const;
+
+protected:
+
+    virtual void timerEvent(QTimerEvent *event);
+
+private:
+
+    static void link(Link *list, Link *link);
+    static void unlink(Link *link);
+
+    int resolution;
+    QVector<Link> buckets;
+    QElapsedTimer clock;
+    qint64 currentTick;
+    int timerId;
+    int entryCount;
+};
+
+#endif // QHTTPENGINE_QHTTPTIMERWHEELPRIVATE_H
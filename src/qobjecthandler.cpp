@@ -22,10 +22,12 @@
 
 #include <QGenericArgument>
 #include <QMetaMethod>
+#include <QThread>
 
 #include <QHttpEngine/QHttpSocket>
 #include <QHttpEngine/QObjectHandler>
 
+#include "qhttpsocket_p.h"
 #include "qobjecthandler_p.h"
 
 QObjectHandlerPrivate::QObjectHandlerPrivate(QObjectHandler *handler)
@@ -40,69 +42,211 @@ QObjectHandler::QObjectHandler(QObject *parent)
 {
 }
 
-void QObjectHandlerPrivate::invokeSlot(QHttpSocket *socket, Method m)
+void QObjectHandlerPrivate::addTemplate(const QString &name, const Method &m)
 {
-    // Invoke the slot
-    if (m.oldSlot) {
+    // The root node is only created once a template is added
+    if (nodes.isEmpty()) {
+        nodes.append(Node());
+    }
 
-        // Obtain the slot index
-        int index = m.receiver->metaObject()->indexOfSlot(m.slot.method + 1);
-        if (index == -1) {
-            socket->writeError(QHttpSocket::InternalServerError);
-            return;
+    int current = 0;
+    foreach (const QString &segment, name.split('/')) {
+        int next = -1;
+
+        if (segment.startsWith('{') && segment.endsWith('}')) {
+
+            // Split "{name:type}" into the name and the type
+            QString spec = segment.mid(1, segment.length() - 2);
+            int colon = spec.indexOf(':');
+
+            Parameter parameter;
+            parameter.name = colon == -1 ? spec : spec.left(colon);
+            parameter.type = colon != -1 && spec.mid(colon + 1) == "int" ?
+                        Parameter::Int : Parameter::String;
+
+            // Share the node with an identical parameter if one exists
+            foreach (const Parameter &existing, nodes.at(current).parameters) {
+                if (existing.name == parameter.name && existing.type == parameter.type) {
+                    next = existing.node;
+                    break;
+                }
+            }
+
+            // Typed parameters are more specific and are tried first
+            if (next == -1) {
+                nodes.append(Node());
+                next = parameter.node = nodes.count() - 1;
+
+                QList<Parameter> &parameters = nodes[current].parameters;
+                if (parameter.type == Parameter::Int) {
+                    parameters.prepend(parameter);
+                } else {
+                    parameters.append(parameter);
+                }
+            }
+        } else {
+            next = nodes.at(current).literals.value(segment, -1);
+            if (next == -1) {
+                nodes.append(Node());
+                next = nodes.count() - 1;
+                nodes[current].literals.insert(segment, next);
+            }
         }
 
-        QMetaMethod method = m.receiver->metaObject()->method(index);
+        current = next;
+    }
 
-        // Ensure the parameter is correct
-        QList<QByteArray> params = method.parameterTypes();
-        if (params.count() != 1 || params.at(0) != "QHttpSocket*") {
-            socket->writeError(QHttpSocket::InternalServerError);
-            return;
+    templateMethods.append(m);
+    nodes[current].method = templateMethods.count() - 1;
+}
+
+bool QObjectHandlerPrivate::matchTemplate(const QStringList &segments, int index, int node, QVariantMap &params, const Method *&m) const
+{
+    const Node &n = nodes.at(node);
+
+    if (index == segments.count()) {
+        if (n.method == -1) {
+            return false;
         }
+        m = &templateMethods.at(n.method);
+        return true;
+    }
 
-        // Invoke the method
-        if (!m.receiver->metaObject()->method(index).invoke(
-                    m.receiver, Q_ARG(QHttpSocket*, socket))) {
-            socket->writeError(QHttpSocket::InternalServerError);
-            return;
+    const QString &segment = segments.at(index);
+
+    // Literal segments take precedence over parameters
+    int next = n.literals.value(segment, -1);
+    if (next != -1 && matchTemplate(segments, index + 1, next, params, m)) {
+        return true;
+    }
+
+    // Convert the segment for each parameter, which also ensures that it is
+    // valid for the type, and try to match the rest of the path
+    foreach (const Parameter &parameter, n.parameters) {
+        QVariant value;
+        if (parameter.type == Parameter::Int) {
+            bool ok;
+            int intValue = segment.toInt(&ok);
+            if (!ok) {
+                continue;
+            }
+            value = intValue;
+        } else {
+            if (segment.isEmpty()) {
+                continue;
+            }
+            value = segment;
+        }
+
+        params.insert(parameter.name, value);
+        if (matchTemplate(segments, index + 1, parameter.node, params, m)) {
+            return true;
         }
+        params.remove(parameter.name);
+    }
+
+    return false;
+}
+
+void QObjectHandlerPrivate::addMethod(const QString &name, const Method &m)
+{
+    if (name.contains('{')) {
+        addTemplate(name, m);
     } else {
-        void *args[] = {
-            Q_NULLPTR,
-            &socket
-        };
-        m.slot.slotObj->call(m.receiver, args);
+        map.insert(name, m);
+    }
+}
+
+void QObjectHandlerPrivate::invokeSlot(QHttpSocket *socket, const Method &m, const QVariantMap &params)
+{
+    void *args[] = {
+        Q_NULLPTR,
+        &socket,
+        const_cast<QVariantMap*>(&params)
+    };
+
+    // Invoke the slot
+    if (m.slotObj) {
+        m.slotObj->call(m.receiver, args);
+    } else if (m.index == -1) {
+
+        // The slot could not be resolved when it was registered
+        socket->writeError(QHttpSocket::InternalServerError);
+    } else if (m.receiver->thread() == QThread::currentThread()) {
+
+        // Call the slot directly by index, which avoids looking up and
+        // checking the parameter types for every request
+        QMetaObject::metacall(m.receiver, QMetaObject::InvokeMetaMethod, m.index, args);
+    } else {
+
+        // The receiver lives in another thread so the call must be queued
+        bool invoked = m.argumentCount == 1 ?
+                m.method.invoke(m.receiver, Q_ARG(QHttpSocket*, socket)) :
+                m.method.invoke(m.receiver, Q_ARG(QHttpSocket*, socket), Q_ARG(QVariantMap, params));
+        if (!invoked) {
+            socket->writeError(QHttpSocket::InternalServerError);
+        }
     }
 }
 
 void QObjectHandler::process(QHttpSocket *socket, const QString &path)
 {
-    // Ensure the method has been registered
-    if (!d->map.contains(path)) {
+    const QObjectHandlerPrivate::Method *m = Q_NULLPTR;
+    QVariantMap params;
+
+    // Ensure the method has been registered, either with the exact name or
+    // with a template that matches the path - methods are referenced in
+    // place rather than copied for each request
+    QHash<QString, QObjectHandlerPrivate::Method>::const_iterator i = d->map.constFind(path);
+    if (i != d->map.constEnd()) {
+        m = &i.value();
+    } else if (d->nodes.isEmpty() || !d->matchTemplate(path.split('/'), 0, 0, params, m)) {
         socket->writeError(QHttpSocket::NotFound);
         return;
     }
 
-    QObjectHandlerPrivate::Method m = d->map.value(path);
-
     // If the slot requires all data to be received, check to see if this is
     // already the case, otherwise, wait until the rest of it arrives
-    if (!m.readAll || socket->bytesAvailable() >= socket->contentLength()) {
-        d->invokeSlot(socket, m);
+    if (!m->readAll || socket->bytesAvailable() >= socket->contentLength()) {
+        d->invokeSlot(socket, *m, params);
     } else {
-        connect(socket, &QHttpSocket::readChannelFinished, [this, socket, m]() {
-            d->invokeSlot(socket, m);
-        });
+        QHttpSocketPrivate::get(socket)->readFinished = [this, socket, m, params]() {
+            d->invokeSlot(socket, *m, params);
+        };
     }
 }
 
 void QObjectHandler::registerMethod(const QString &name, QObject *receiver, const char *method, bool readAll)
 {
-    d->map.insert(name, QObjectHandlerPrivate::Method(receiver, method, readAll));
+    QObjectHandlerPrivate::Method m;
+    m.receiver = receiver;
+    m.readAll = readAll;
+
+    // Resolve the slot (skipping the code added by the SLOT() macro) and
+    // ensure that it has the correct parameters - if not, the index remains
+    // -1 and requests will receive an error
+    const QMetaObject *metaObject = receiver->metaObject();
+    int index = metaObject->indexOfSlot(QMetaObject::normalizedSignature(method + 1).constData());
+    if (index != -1) {
+        QMetaMethod metaMethod = metaObject->method(index);
+        QList<QByteArray> types = metaMethod.parameterTypes();
+        if (types.count() >= 1 && types.count() <= 2 && types.at(0) == "QHttpSocket*" &&
+                (types.count() == 1 || types.at(1) == "QVariantMap")) {
+            m.method = metaMethod;
+            m.index = index;
+            m.argumentCount = types.count();
+        }
+    }
+
+    d->addMethod(name, m);
 }
 
 void QObjectHandler::registerMethodImpl(const QString &name, QObject *receiver, QtPrivate::QSlotObjectBase *slotObj, bool readAll)
 {
-    d->map.insert(name, QObjectHandlerPrivate::Method(receiver, slotObj, readAll));
+    QObjectHandlerPrivate::Method m;
+    m.receiver = receiver;
+    m.slotObj = slotObj;
+    m.readAll = readAll;
+
+    d->addMethod(name, m);
 }
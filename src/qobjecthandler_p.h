@@ -23,8 +23,13 @@
 #ifndef QHTTPENGINE_QOBJECTHANDLERPRIVATE_H
 #define QHTTPENGINE_QOBJECTHANDLERPRIVATE_H
 
-#include <QMap>
+#include <QHash>
+#include <QList>
+#include <QMetaMethod>
 #include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
 
 class QHttpSocket;
 class QObjectHandler;
@@ -38,31 +43,55 @@ public:
     explicit QObjectHandlerPrivate(QObjectHandler *handler);
 
     // In order to invoke the slot, a "pointer" to it needs to be stored in a
-    // map that lets us look up information by method name
+    // hash that lets us look up information by method name - slots using the
+    // old syntax are resolved and validated once when they are registered
 
     class Method {
     public:
-        Method() {}
-        Method(QObject *receiver, const char *method, bool readAll)
-            : receiver(receiver), oldSlot(true), slot(method), readAll(readAll) {}
-        Method(QObject *receiver, QtPrivate::QSlotObjectBase *slotObj, bool readAll)
-            : receiver(receiver), oldSlot(false), slot(slotObj), readAll(readAll) {}
+        Method() : receiver(Q_NULLPTR), slotObj(Q_NULLPTR), index(-1), argumentCount(0), readAll(true) {}
 
         QObject *receiver;
-        bool oldSlot;
-        union slot{
-            slot() {}
-            slot(const char *method) : method(method) {}
-            slot(QtPrivate::QSlotObjectBase *slotObj) : slotObj(slotObj) {}
-            const char *method;
-            QtPrivate::QSlotObjectBase *slotObj;
-        } slot;
+        QtPrivate::QSlotObjectBase *slotObj;
+        QMetaMethod method;
+        int index;
+        int argumentCount;
         bool readAll;
     };
 
-    void invokeSlot(QHttpSocket *socket, Method m);
+    // Templates are compiled into a tree with one level per path segment;
+    // each node has a hash of literal segments and a list of parameters
 
-    QMap<QString, Method> map;
+    class Parameter {
+    public:
+        enum Type {
+            String,
+            Int
+        };
+
+        QString name;
+        Type type;
+        int node;
+    };
+
+    class Node {
+    public:
+        Node() : method(-1) {}
+
+        QHash<QString, int> literals;
+        QList<Parameter> parameters;
+        int method;
+    };
+
+    void addTemplate(const QString &name, const Method &m);
+    bool matchTemplate(const QStringList &segments, int index, int node, QVariantMap &params, const Method *&m) const;
+
+    void addMethod(const QString &name, const Method &m);
+    void invokeSlot(QHttpSocket *socket, const Method &m, const QVariantMap &params);
+
+    QHash<QString, Method> map;
+
+    QVector<Node> nodes;
+    QList<Method> templateMethods;
 
 private:
 
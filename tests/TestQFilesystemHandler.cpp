@@ -49,6 +49,11 @@ private Q_SLOTS:
     void testRequests_data();
     void testRequests();
 
+    void testListing_data();
+    void testListing();
+    void testLargeListing_data();
+    void testLargeListing();
+
 private:
 
     bool createFile(const QString &path);
@@ -193,6 +198,104 @@ void TestQFilesystemHandler::testRangeRequests()
     }
 }
 
+void TestQFilesystemHandler::testListing_data()
+{
+    QTest::addColumn<QByteArray>("accept");
+    QTest::addColumn<QByteArray>("contentType");
+    QTest::addColumn<QByteArray>("entry");
+
+    QTest::newRow("html")
+            << QByteArray("text/html")
+            << QByteArray("text/html")
+            << QByteArray("<li><a href=\"inside\">inside</a></li>");
+
+    QTest::newRow("json")
+            << QByteArray("application/json")
+            << QByteArray("application/json")
+            << QByteArray("{\"name\":\"inside\",\"type\":\"file\"}");
+}
+
+void TestQFilesystemHandler::testListing()
+{
+    QFETCH(QByteArray, accept);
+    QFETCH(QByteArray, contentType);
+    QFETCH(QByteArray, entry);
+
+    QFilesystemHandler handler(QDir(dir.path()).absoluteFilePath("root"));
+
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    QHttpSocket::HeaderMap inHeaders;
+    inHeaders.insert("Accept", accept);
+    client.sendHeaders("GET", "/", inHeaders);
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    handler.route(&socket, "");
+
+    QTRY_COMPARE(client.statusCode(), static_cast<int>(QHttpSocket::OK));
+    QCOMPARE(client.headers().value("Content-Type"), contentType);
+    QTRY_VERIFY(client.data().contains(entry));
+}
+
+void TestQFilesystemHandler::testLargeListing_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("sorted");
+
+    QTest::newRow("sorted")
+            << 2000
+            << true;
+
+    QTest::newRow("unsorted")
+            << 5000
+            << false;
+}
+
+void TestQFilesystemHandler::testLargeListing()
+{
+    QFETCH(int, count);
+    QFETCH(bool, sorted);
+
+    // Enough entries for several batches, created in reverse order
+    QString name = QString("large%1").arg(count);
+    QVERIFY(createDirectory(name));
+    for (int i = count - 1; i >= 0; --i) {
+        QVERIFY(createFile(QString("%1/f%2").arg(name).arg(i, 4, 10, QChar('0'))));
+    }
+
+    QFilesystemHandler handler(QDir(dir.path()).absoluteFilePath(name));
+
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", "/");
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    handler.route(&socket, "");
+
+    QTRY_VERIFY_WITH_TIMEOUT(client.data().endsWith("</html>"), 10000);
+
+    // Every entry is listed, in order if the listing is small enough
+    QByteArray data = client.data();
+    QCOMPARE(data.count("<li>"), count);
+    int previous = -1;
+    for (int i = 0; i < count; ++i) {
+        int index = data.indexOf(QString("<li><a href=\"f%1\">").arg(i, 4, 10, QChar('0')).toUtf8());
+        QVERIFY(index != -1);
+        if (sorted) {
+            QVERIFY(index > previous);
+            previous = index;
+        }
+    }
+}
+
 bool TestQFilesystemHandler::createFile(const QString &path)
 {
     QFile file(QDir(dir.path()).absoluteFilePath(path));
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QFile>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <QHttpEngine/QHttpAccessLog>
+#include <QHttpEngine/QHttpHandler>
+#include <QHttpEngine/QHttpSocket>
+
+#include "common/qsimplehttpclient.h"
+#include "common/qsocketpair.h"
+
+Q_DECLARE_METATYPE(QHttpAccessLog::Format)
+
+const QByteArray Path = "/test?a=\"b\"";
+const QByteArray UserAgent = "Test/1.0";
+
+class TestQHttpAccessLog : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testFormat_data();
+    void testFormat();
+
+    void testSampling();
+    void testDropping();
+    void testRotation();
+
+private:
+
+    void request(QHttpAccessLog *accessLog, int *size = 0);
+    void readLines(const QString &fileName, QList<QByteArray> &lines);
+};
+
+void TestQHttpAccessLog::request(QHttpAccessLog *accessLog, int *size)
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+    QSignalSpy requestCompletedSpy(&socket, SIGNAL(requestCompleted()));
+
+    QHttpHandler handler;
+    handler.addMiddleware(accessLog);
+
+    client.sendHeaders("GET", Path, QHttpSocket::HeaderMap{{"User-Agent", UserAgent}});
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    handler.route(&socket, socket.path().mid(1));
+
+    QTRY_COMPARE(requestCompletedSpy.count(), 1);
+
+    if (size) {
+        QTRY_VERIFY(client.isDataReceived());
+        *size = client.data().length();
+    }
+}
+
+void TestQHttpAccessLog::readLines(const QString &fileName, QList<QByteArray> &lines)
+{
+    QFile file(fileName);
+    lines.clear();
+    if (file.open(QIODevice::ReadOnly)) {
+        lines = file.readAll().split('\n');
+        lines.removeLast();
+    }
+}
+
+void TestQHttpAccessLog::testFormat_data()
+{
+    QTest::addColumn<QHttpAccessLog::Format>("format");
+    QTest::addColumn<QByteArray>("pattern");
+
+    QTest::newRow("common")
+            << QHttpAccessLog::CommonFormat
+            << QByteArray("^127\\.0\\.0\\.1 - - \\[\\d\\d/\\w\\w\\w/\\d{4}:\\d\\d:\\d\\d:\\d\\d \\+0000\\] "
+                          "\"GET /test\\?a=\\\\\"b\\\\\"\" 404 %1$");
+
+    QTest::newRow("combined")
+            << QHttpAccessLog::CombinedFormat
+            << QByteArray("^127\\.0\\.0\\.1 - - \\[.*\\] \"GET /test\\?a=\\\\\"b\\\\\"\" 404 %1 "
+                          "\"-\" \"Test/1\\.0\"$");
+
+    QTest::newRow("json")
+            << QHttpAccessLog::JsonFormat
+            << QByteArray("^\\{\"time\":\"\\d{4}-\\d\\d-\\d\\dT\\d\\d:\\d\\d:\\d\\dZ\",\"remote_addr\":\"127\\.0\\.0\\.1\","
+                          "\"method\":\"GET\",\"path\":\"/test\\?a=\\\\\"b\\\\\"\",\"status\":404,"
+                          "\"bytes_sent\":%1,\"duration_us\":\\d+,\"referer\":\"\",\"user_agent\":\"Test/1\\.0\"\\}$");
+}
+
+void TestQHttpAccessLog::testFormat()
+{
+    QFETCH(QHttpAccessLog::Format, format);
+    QFETCH(QByteArray, pattern);
+
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/access.log";
+
+    QHttpAccessLog accessLog(fileName);
+    accessLog.setFormat(format);
+
+    int size;
+    request(&accessLog, &size);
+    accessLog.flush();
+
+    // The size logged is that of the body alone
+    QList<QByteArray> lines;
+    readLines(fileName, lines);
+    QCOMPARE(lines.count(), 1);
+    QVERIFY(QRegularExpression(QString::fromLatin1(pattern).arg(size)).match(QString::fromLatin1(lines.at(0))).hasMatch());
+}
+
+void TestQHttpAccessLog::testSampling()
+{
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/access.log";
+
+    QHttpAccessLog accessLog(fileName);
+    accessLog.setSampleInterval(2);
+
+    request(&accessLog);
+    request(&accessLog);
+    request(&accessLog);
+    accessLog.flush();
+
+    QList<QByteArray> lines;
+    readLines(fileName, lines);
+    QCOMPARE(lines.count(), 2);
+}
+
+void TestQHttpAccessLog::testDropping()
+{
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/access.log";
+
+    QHttpAccessLog accessLog(fileName);
+    accessLog.setMaxPendingSize(0);
+
+    request(&accessLog);
+    accessLog.flush();
+
+    QList<QByteArray> lines;
+    readLines(fileName, lines);
+    QCOMPARE(lines.count(), 0);
+    QCOMPARE(accessLog.droppedLines(), 1);
+}
+
+void TestQHttpAccessLog::testRotation()
+{
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/access.log";
+
+    QHttpAccessLog accessLog(fileName);
+    accessLog.setMaxFileSize(1);
+    accessLog.setMaxFiles(1);
+
+    // Each batch is written to a new file, keeping only the previous one
+    for (int i = 0; i < 3; ++i) {
+        request(&accessLog);
+        accessLog.flush();
+    }
+
+    QList<QByteArray> lines;
+    readLines(fileName, lines);
+    QCOMPARE(lines.count(), 1);
+    readLines(fileName + ".1", lines);
+    QCOMPARE(lines.count(), 1);
+    QVERIFY(!QFile::exists(fileName + ".2"));
+}
+
+QTEST_MAIN(TestQHttpAccessLog)
+#include "TestQHttpAccessLog.moc"
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <QList>
+#include <QTest>
+
+#include <QHttpEngine/QHttpAsyncMiddleware>
+#include <QHttpEngine/QHttpHandler>
+#include <QHttpEngine/QHttpSocket>
+
+#include "common/qsimplehttpclient.h"
+#include "common/qsocketpair.h"
+
+class DummyMiddleware : public QHttpAsyncMiddleware
+{
+    Q_OBJECT
+
+public:
+
+    DummyMiddleware() : mCancelled(0) {}
+
+    void decide(bool proceed) {
+        foreach (QHttpSocket *socket, mSockets) {
+            if (!proceed) {
+                socket->writeError(QHttpSocket::Forbidden);
+            }
+            finish(socket, proceed);
+        }
+        mSockets.clear();
+    }
+
+    QList<QHttpSocket*> mSockets;
+    int mCancelled;
+
+protected:
+
+    virtual void start(QHttpSocket *socket) {
+        mSockets.append(socket);
+    }
+
+    virtual void cancel(QHttpSocket *socket) {
+        mSockets.removeAll(socket);
+        ++mCancelled;
+    }
+};
+
+class TestQHttpAsyncMiddleware : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testDecision_data();
+    void testDecision();
+
+    void testTimeout();
+    void testDisconnect();
+    void testReplace();
+};
+
+void TestQHttpAsyncMiddleware::testDecision_data()
+{
+    QTest::addColumn<bool>("proceed");
+    QTest::addColumn<int>("statusCode");
+
+    QTest::newRow("proceed")
+            << true
+            << static_cast<int>(QHttpSocket::NotFound);
+
+    QTest::newRow("deny")
+            << false
+            << static_cast<int>(QHttpSocket::Forbidden);
+}
+
+void TestQHttpAsyncMiddleware::testDecision()
+{
+    QFETCH(bool, proceed);
+    QFETCH(int, statusCode);
+
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", "/");
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    DummyMiddleware middleware;
+    QHttpHandler handler;
+    handler.addMiddleware(&middleware);
+    handler.route(&socket, "/");
+
+    // Nothing is written until the middleware decides
+    QCOMPARE(middleware.mSockets.count(), 1);
+    QTest::qWait(50);
+    QCOMPARE(client.statusCode(), 0);
+
+    middleware.decide(proceed);
+    QTRY_COMPARE(client.statusCode(), statusCode);
+}
+
+void TestQHttpAsyncMiddleware::testTimeout()
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", "/");
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    DummyMiddleware middleware;
+    middleware.setTimeout(100);
+    QHttpHandler handler;
+    handler.addMiddleware(&middleware);
+    handler.route(&socket, "/");
+
+    QTRY_COMPARE(client.statusCode(), static_cast<int>(QHttpSocket::GatewayTimeout));
+    QCOMPARE(middleware.mCancelled, 1);
+    QVERIFY(middleware.mSockets.isEmpty());
+}
+
+void TestQHttpAsyncMiddleware::testDisconnect()
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", "/");
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    DummyMiddleware middleware;
+    QHttpHandler handler;
+    handler.addMiddleware(&middleware);
+    handler.route(&socket, "/");
+
+    pair.client()->disconnectFromHost();
+    QTRY_COMPARE(middleware.mCancelled, 1);
+    QVERIFY(middleware.mSockets.isEmpty());
+}
+
+void TestQHttpAsyncMiddleware::testReplace()
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", "/");
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    DummyMiddleware middleware;
+    QHttpHandler handler;
+    handler.addMiddleware(&middleware);
+    handler.route(&socket, "/");
+
+    // Routing the socket again cancels the pending decision
+    handler.route(&socket, "/");
+    QCOMPARE(middleware.mCancelled, 1);
+    QCOMPARE(middleware.mSockets.count(), 1);
+
+    middleware.decide(false);
+    QTRY_COMPARE(client.statusCode(), static_cast<int>(QHttpSocket::Forbidden));
+}
+
+QTEST_MAIN(TestQHttpAsyncMiddleware)
+#include "TestQHttpAsyncMiddleware.moc"
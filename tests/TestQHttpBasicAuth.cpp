@@ -32,6 +32,25 @@
 const QString Username = "username";
 const QString Password = "password";
 
+class CountingBasicAuth : public QHttpBasicAuth
+{
+    Q_OBJECT
+
+public:
+
+    CountingBasicAuth() : QHttpBasicAuth("Test"), mVerifyCount(0), mRevoked(false) {}
+
+    int mVerifyCount;
+    bool mRevoked;
+
+protected:
+
+    virtual bool verify(const QString &username, const QString &password) {
+        ++mVerifyCount;
+        return !mRevoked && QHttpBasicAuth::verify(username, password);
+    }
+};
+
 class TestQHttpBasicAuth : public QObject
 {
     Q_OBJECT
@@ -47,8 +66,14 @@ private Q_SLOTS:
     void testProcess_data();
     void testProcess();
 
+    void testHash();
+    void testCache();
+
 private:
 
+    void request(QHttpBasicAuth *auth, const QString &username, const QString &password, int statusCode);
+
+
     QHttpBasicAuth auth;
 };
 
@@ -115,5 +140,64 @@ void TestQHttpBasicAuth::testProcess()
     QTRY_COMPARE(client.statusCode(), status);
 }
 
+void TestQHttpBasicAuth::request(QHttpBasicAuth *auth, const QString &username, const QString &password, int statusCode)
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    QHttpSocket::HeaderMap headers;
+    headers.insert(
+        "Authorization",
+        "Basic " + QString("%1:%2").arg(username).arg(password).toUtf8().toBase64()
+    );
+    client.sendHeaders("GET", "/", headers);
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    QHttpHandler handler;
+    handler.addMiddleware(auth);
+    handler.route(&socket, "/");
+
+    QTRY_COMPARE(client.statusCode(), statusCode);
+}
+
+void TestQHttpBasicAuth::testHash()
+{
+    QHttpBasicAuth hashAuth("Test");
+    QVERIFY(!hashAuth.addHash(Username, "invalid"));
+    QVERIFY(hashAuth.addHash(Username, QHttpBasicAuth::hashPassword(Password, 100)));
+
+    request(&hashAuth, Username, Password, static_cast<int>(QHttpSocket::NotFound));
+    request(&hashAuth, Username, "wrong", static_cast<int>(QHttpSocket::Unauthorized));
+    request(&hashAuth, "unknown", Password, static_cast<int>(QHttpSocket::Unauthorized));
+}
+
+void TestQHttpBasicAuth::testCache()
+{
+    CountingBasicAuth countingAuth;
+    countingAuth.add(Username, Password);
+
+    // verify() is invoked for every request, even once the credentials are
+    // remembered
+    request(&countingAuth, Username, Password, static_cast<int>(QHttpSocket::NotFound));
+    request(&countingAuth, Username, Password, static_cast<int>(QHttpSocket::NotFound));
+    QCOMPARE(countingAuth.mVerifyCount, 2);
+
+    // Invalid credentials are never remembered
+    request(&countingAuth, Username, "wrong", static_cast<int>(QHttpSocket::Unauthorized));
+    request(&countingAuth, Username, "wrong", static_cast<int>(QHttpSocket::Unauthorized));
+
+    // Credentials rejected by a derived class are not accepted from the cache
+    countingAuth.mRevoked = true;
+    request(&countingAuth, Username, Password, static_cast<int>(QHttpSocket::Unauthorized));
+    countingAuth.mRevoked = false;
+
+    // Changing the credentials clears the cache
+    countingAuth.add(Username, "new");
+    request(&countingAuth, Username, Password, static_cast<int>(QHttpSocket::Unauthorized));
+}
+
 QTEST_MAIN(TestQHttpBasicAuth)
 #include "TestQHttpBasicAuth.moc"
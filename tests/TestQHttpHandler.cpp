@@ -21,6 +21,7 @@
  */
 
 #include <QRegExp>
+#include <QRegularExpression>
 #include <QTest>
 
 #include <QHttpEngine/QHttpSocket>
@@ -55,6 +56,15 @@ private Q_SLOTS:
 
     void testSubHandler_data();
     void testSubHandler();
+
+    void testPrecedence_data();
+    void testPrecedence();
+
+    void testRegularExpression_data();
+    void testRegularExpression();
+
+    void testLimits();
+    void testAdmissionControl();
 };
 
 void TestQHttpHandler::testRedirect_data()
@@ -138,6 +148,30 @@ void TestQHttpHandler::testSubHandler_data()
             << QByteArray("one/two")
             << QString("two")
             << static_cast<int>(QHttpSocket::OK);
+
+    QTest::newRow("literal prefix")
+            << QRegExp("^one/")
+            << QByteArray("one/two")
+            << QString("two")
+            << static_cast<int>(QHttpSocket::OK);
+
+    QTest::newRow("literal prefix no match")
+            << QRegExp("^one/")
+            << QByteArray("two/one/")
+            << QString("")
+            << static_cast<int>(QHttpSocket::NotFound);
+
+    QTest::newRow("literal exact")
+            << QRegExp("^one\\.two$")
+            << QByteArray("one.two")
+            << QString("")
+            << static_cast<int>(QHttpSocket::OK);
+
+    QTest::newRow("literal exact no match")
+            << QRegExp("^one$")
+            << QByteArray("one/two")
+            << QString("")
+            << static_cast<int>(QHttpSocket::NotFound);
 }
 
 void TestQHttpHandler::testSubHandler()
@@ -166,5 +200,213 @@ void TestQHttpHandler::testSubHandler()
     QCOMPARE(subHandler.mPathRemainder, pathRemainder);
 }
 
+void TestQHttpHandler::testPrecedence_data()
+{
+    QTest::addColumn<QRegExp>("pattern1");
+    QTest::addColumn<QRegExp>("pattern2");
+    QTest::addColumn<QByteArray>("path");
+    QTest::addColumn<QString>("pathRemainder1");
+    QTest::addColumn<QString>("pathRemainder2");
+
+    QTest::newRow("literal before literal")
+            << QRegExp("^te")
+            << QRegExp("^tes")
+            << QByteArray("test")
+            << QString("st")
+            << QString();
+
+    QTest::newRow("longer literal first")
+            << QRegExp("^tes")
+            << QRegExp("^te")
+            << QByteArray("test")
+            << QString("t")
+            << QString();
+
+    QTest::newRow("regexp before literal")
+            << QRegExp("t(e)")
+            << QRegExp("^tes")
+            << QByteArray("test")
+            << QString("st")
+            << QString();
+
+    QTest::newRow("literal before regexp")
+            << QRegExp("^tes")
+            << QRegExp("t(e)")
+            << QByteArray("test")
+            << QString("t")
+            << QString();
+
+    QTest::newRow("regexp after failed literal")
+            << QRegExp("^abc")
+            << QRegExp("t")
+            << QByteArray("test")
+            << QString()
+            << QString("est");
+}
+
+void TestQHttpHandler::testPrecedence()
+{
+    QFETCH(QRegExp, pattern1);
+    QFETCH(QRegExp, pattern2);
+    QFETCH(QByteArray, path);
+    QFETCH(QString, pathRemainder1);
+    QFETCH(QString, pathRemainder2);
+
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", path);
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    DummyHandler subHandler1;
+    DummyHandler subHandler2;
+    QHttpHandler handler;
+    handler.addSubHandler(pattern1, &subHandler1);
+    handler.addSubHandler(pattern2, &subHandler2);
+
+    handler.route(&socket, socket.path());
+
+    QTRY_COMPARE(client.statusCode(), static_cast<int>(QHttpSocket::OK));
+    QCOMPARE(subHandler1.mPathRemainder.isNull(), pathRemainder1.isNull());
+    QCOMPARE(subHandler2.mPathRemainder.isNull(), pathRemainder2.isNull());
+    QCOMPARE(subHandler1.mPathRemainder, pathRemainder1);
+    QCOMPARE(subHandler2.mPathRemainder, pathRemainder2);
+}
+
+void TestQHttpHandler::testRegularExpression_data()
+{
+    QTest::addColumn<QRegularExpression>("redirectPattern");
+    QTest::addColumn<QString>("destination");
+    QTest::addColumn<QRegularExpression>("subHandlerPattern");
+    QTest::addColumn<QByteArray>("path");
+    QTest::addColumn<int>("statusCode");
+    QTest::addColumn<QByteArray>("location");
+    QTest::addColumn<QString>("pathRemainder");
+
+    QTest::newRow("redirect")
+            << QRegularExpression("^(\\w+)/(\\d+)$")
+            << QString("/%2/%1/%2")
+            << QRegularExpression("^none/")
+            << QByteArray("one/123")
+            << static_cast<int>(QHttpSocket::Found)
+            << QByteArray("/123/one/123")
+            << QString();
+
+    QTest::newRow("sub-handler")
+            << QRegularExpression("^none/")
+            << QString("/")
+            << QRegularExpression("^o\\w+/")
+            << QByteArray("one/two")
+            << static_cast<int>(QHttpSocket::OK)
+            << QByteArray()
+            << QString("two");
+
+    QTest::newRow("sub-handler unanchored")
+            << QRegularExpression("^none/")
+            << QString("/")
+            << QRegularExpression("\\d+/")
+            << QByteArray("one/123/two")
+            << static_cast<int>(QHttpSocket::OK)
+            << QByteArray()
+            << QString("two");
+
+    QTest::newRow("no match")
+            << QRegularExpression("^none/")
+            << QString("/")
+            << QRegularExpression("^\\d+")
+            << QByteArray("test")
+            << static_cast<int>(QHttpSocket::NotFound)
+            << QByteArray()
+            << QString();
+}
+
+void TestQHttpHandler::testRegularExpression()
+{
+    QFETCH(QRegularExpression, redirectPattern);
+    QFETCH(QString, destination);
+    QFETCH(QRegularExpression, subHandlerPattern);
+    QFETCH(QByteArray, path);
+    QFETCH(int, statusCode);
+    QFETCH(QByteArray, location);
+    QFETCH(QString, pathRemainder);
+
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", path);
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    DummyHandler subHandler;
+    QHttpHandler handler;
+    handler.addRedirect(redirectPattern, destination);
+    handler.addSubHandler(subHandlerPattern, &subHandler);
+
+    handler.route(&socket, socket.path());
+
+    QTRY_COMPARE(client.statusCode(), statusCode);
+    QCOMPARE(subHandler.mPathRemainder, pathRemainder);
+
+    if (statusCode == QHttpSocket::Found) {
+        QCOMPARE(client.headers().value("Location"), location);
+    }
+}
+
+void TestQHttpHandler::testLimits()
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", "/path");
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    DummyHandler handler;
+    handler.setLimit(QHttpSocket::MaxUriLength, 4);
+    handler.route(&socket, socket.path());
+
+    QTRY_COMPARE(client.statusCode(), static_cast<int>(QHttpSocket::UriTooLong));
+    QVERIFY(handler.mPathRemainder.isNull());
+}
+
+void TestQHttpHandler::testAdmissionControl()
+{
+    QSocketPair pair1, pair2, pair3;
+    QTRY_VERIFY(pair1.isConnected() && pair2.isConnected() && pair3.isConnected());
+
+    QSimpleHttpClient client1(pair1.client()), client2(pair2.client()), client3(pair3.client());
+    QHttpSocket socket1(pair1.server()), socket2(pair2.server()), socket3(pair3.server());
+
+    client1.sendHeaders("GET", "/1");
+    client2.sendHeaders("GET", "/2");
+    client3.sendHeaders("GET", "/health");
+    QTRY_VERIFY(socket1.isHeadersParsed() && socket2.isHeadersParsed() && socket3.isHeadersParsed());
+
+    // With a target and interval of zero, no delay is below the target and
+    // the handler is overloaded from the second request onwards
+    DummyHandler handler;
+    handler.setAdmissionControl(0, 0);
+    handler.addCriticalRoute(QRegularExpression("^health$"));
+
+    // The first request is admitted, after which only the critical route is
+    handler.route(&socket1, socket1.path().mid(1));
+    handler.route(&socket2, socket2.path().mid(1));
+    handler.route(&socket3, socket3.path().mid(1));
+
+    QTRY_COMPARE(client1.statusCode(), static_cast<int>(QHttpSocket::OK));
+    QTRY_COMPARE(client2.statusCode(), static_cast<int>(QHttpSocket::ServiceUnavailable));
+    QCOMPARE(client2.headers().value("Retry-After"), QByteArray("1"));
+    QTRY_COMPARE(client3.statusCode(), static_cast<int>(QHttpSocket::OK));
+    QCOMPARE(handler.mPathRemainder, QString("health"));
+    QCOMPARE(handler.shedCount(), Q_INT64_C(1));
+}
+
 QTEST_MAIN(TestQHttpHandler)
 #include "TestQHttpHandler.moc"
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QObject>
+#include <QRegularExpression>
+#include <QTest>
+
+#include <QHttpEngine/QHttpHandler>
+#include <QHttpEngine/QHttpMetricsHandler>
+#include <QHttpEngine/QHttpSocket>
+
+#include "common/qsimplehttpclient.h"
+#include "common/qsocketpair.h"
+
+class TestQHttpMetricsHandler : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testExposition();
+
+private:
+
+    void request(QHttpHandler *handler, const QByteArray &path, int statusCode, QByteArray &data);
+};
+
+void TestQHttpMetricsHandler::request(QHttpHandler *handler, const QByteArray &path, int statusCode, QByteArray &data)
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", path);
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    handler->route(&socket, socket.path().mid(1));
+
+    QTRY_COMPARE(client.statusCode(), statusCode);
+    QTRY_VERIFY(client.isDataReceived());
+
+    data = client.data();
+}
+
+void TestQHttpMetricsHandler::testExposition()
+{
+    QHttpMetricsHandler metricsHandler;
+    QHttpHandler handler;
+    handler.setObjectName("root");
+    handler.addSubHandler(QRegularExpression("^metrics$"), &metricsHandler);
+
+    QByteArray data;
+    request(&handler, "/missing", QHttpSocket::NotFound, data);
+    request(&handler, "/metrics", QHttpSocket::OK, data);
+
+    QVERIFY(data.contains("# TYPE qhttpengine_requests_total counter\n"));
+    QVERIFY(data.contains("qhttpengine_requests_total{method=\"GET\",code=\"404\"} 1\n"));
+    QVERIFY(data.contains("qhttpengine_request_duration_seconds_bucket{handler=\"root\",le=\"+Inf\"} 1\n"));
+    QVERIFY(data.contains("qhttpengine_request_duration_seconds_count{handler=\"root\"} 1\n"));
+
+    // The request for the metrics is recorded once it completes
+    QVERIFY(QHttpMetricsHandler::exposition().contains(
+        "qhttpengine_request_duration_seconds_count{handler=\"QHttpMetricsHandler\"} 1\n"));
+}
+
+QTEST_MAIN(TestQHttpMetricsHandler)
+#include "TestQHttpMetricsHandler.moc"
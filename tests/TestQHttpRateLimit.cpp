@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2015 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <QTest>
+
+#include <QHttpEngine/QHttpHandler>
+#include <QHttpEngine/QHttpRateLimit>
+#include <QHttpEngine/QHttpSocket>
+
+#include "common/qsimplehttpclient.h"
+#include "common/qsocketpair.h"
+
+class TestQHttpRateLimit : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testRequestRate();
+    void testByteRate();
+    void testApiKey();
+
+private:
+
+    void request(QHttpRateLimit *rateLimit, const QHttpSocket::HeaderMap &headers, int statusCode);
+};
+
+void TestQHttpRateLimit::request(QHttpRateLimit *rateLimit, const QHttpSocket::HeaderMap &headers, int statusCode)
+{
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", "/", headers);
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    QHttpHandler handler;
+    handler.addMiddleware(rateLimit);
+    handler.route(&socket, "/");
+
+    QTRY_COMPARE(client.statusCode(), statusCode);
+    if (statusCode == QHttpSocket::TooManyRequests) {
+        QVERIFY(client.headers().value("Retry-After").toInt() > 0);
+    }
+}
+
+void TestQHttpRateLimit::testRequestRate()
+{
+    QHttpRateLimit rateLimit;
+    rateLimit.setRequestRate(QHttpRateLimit::ClientAddress, 0.1, 2);
+
+    request(&rateLimit, QHttpSocket::HeaderMap(), QHttpSocket::NotFound);
+    request(&rateLimit, QHttpSocket::HeaderMap(), QHttpSocket::NotFound);
+    request(&rateLimit, QHttpSocket::HeaderMap(), QHttpSocket::TooManyRequests);
+
+    QCOMPARE(rateLimit.limitedCount(), Q_INT64_C(1));
+}
+
+void TestQHttpRateLimit::testByteRate()
+{
+    QHttpRateLimit rateLimit;
+    rateLimit.setByteRate(QHttpRateLimit::ClientAddress, 1, 1000);
+
+    // The headers of each request are a little under 200 bytes
+    QHttpSocket::HeaderMap headers;
+    headers.insert("X-Padding", QByteArray(150, 'a'));
+
+    for (int i = 0; i < 5; ++i) {
+        request(&rateLimit, headers, QHttpSocket::NotFound);
+    }
+    request(&rateLimit, headers, QHttpSocket::TooManyRequests);
+}
+
+void TestQHttpRateLimit::testApiKey()
+{
+    QHttpRateLimit rateLimit;
+    rateLimit.setRequestRate(QHttpRateLimit::ApiKey, 0.1, 1);
+
+    QHttpSocket::HeaderMap headers1, headers2;
+    headers1.insert("X-API-Key", "1");
+    headers2.insert("X-API-Key", "2");
+
+    request(&rateLimit, headers1, QHttpSocket::NotFound);
+    request(&rateLimit, headers1, QHttpSocket::TooManyRequests);
+    request(&rateLimit, headers2, QHttpSocket::NotFound);
+
+    // Requests without a key are not limited
+    request(&rateLimit, QHttpSocket::HeaderMap(), QHttpSocket::NotFound);
+    request(&rateLimit, QHttpSocket::HeaderMap(), QHttpSocket::NotFound);
+}
+
+QTEST_MAIN(TestQHttpRateLimit)
+#include "TestQHttpRateLimit.moc"
@@ -53,6 +53,9 @@ class TestQHttpServer : public QObject
 private Q_SLOTS:
 
     void testServer();
+    void testSoftConnectionLimit();
+    void testMaxConnections();
+    void testSocketOptions();
 };
 
 void TestQHttpServer::testServer()
@@ -77,5 +80,96 @@ void TestQHttpServer::testServer()
     QTRY_COMPARE(destroyedSpy.count(), 1);
 }
 
+void TestQHttpServer::testSoftConnectionLimit()
+{
+    TestHandler handler;
+    QHttpServer server(&handler);
+    server.setSoftConnectionLimit(1);
+    server.setRetryAfter(10);
+
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    QTcpSocket socket1;
+    socket1.connectToHost(server.serverAddress(), server.serverPort());
+    QSimpleHttpClient client1(&socket1);
+    QTRY_COMPARE(server.activeConnections(), 1);
+
+    // The request is never read by the server but must not prevent the
+    // response from reaching the client
+    QTcpSocket socket2;
+    socket2.connectToHost(server.serverAddress(), server.serverPort());
+    QSimpleHttpClient client2(&socket2);
+    client2.sendHeaders("POST", "/", QHttpSocket::HeaderMap{{"Content-Length", "65536"}});
+    client2.sendData(QByteArray(65536, 'x'));
+
+    QTRY_COMPARE(client2.statusCode(), static_cast<int>(QHttpSocket::ServiceUnavailable));
+    QCOMPARE(client2.headers().value("Retry-After"), QByteArray("10"));
+    QCOMPARE(server.acceptedConnections(), Q_INT64_C(1));
+    QCOMPARE(server.rejectedConnections(), Q_INT64_C(1));
+
+    socket1.disconnectFromHost();
+    QTRY_COMPARE(server.activeConnections(), 0);
+}
+
+void TestQHttpServer::testMaxConnections()
+{
+    TestHandler handler;
+    QHttpServer server(&handler);
+    server.setMaxConnections(1);
+
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    QTcpSocket socket1;
+    socket1.connectToHost(server.serverAddress(), server.serverPort());
+    QTRY_COMPARE(socket1.state(), QAbstractSocket::ConnectedState);
+
+    QSimpleHttpClient client1(&socket1);
+    client1.sendHeaders("GET", "/1");
+    QTRY_COMPARE(handler.mPath, QString("1"));
+
+    // The second connection must wait until the first one is closed
+    QTcpSocket socket2;
+    socket2.connectToHost(server.serverAddress(), server.serverPort());
+    QTRY_COMPARE(socket2.state(), QAbstractSocket::ConnectedState);
+
+    QSimpleHttpClient client2(&socket2);
+    client2.sendHeaders("GET", "/2");
+    QTest::qWait(100);
+    QCOMPARE(handler.mPath, QString("1"));
+    QCOMPARE(server.activeConnections(), 1);
+
+    handler.mSocket->close();
+    QTRY_COMPARE(handler.mPath, QString("2"));
+    QCOMPARE(server.acceptedConnections(), Q_INT64_C(2));
+}
+
+void TestQHttpServer::testSocketOptions()
+{
+    TestHandler handler;
+    QHttpServer server(&handler);
+    server.setSocketOption(QHttpServer::ListenBacklog, 128);
+    server.setSocketOption(QHttpServer::NoDelay, 1);
+    server.setSocketOption(QHttpServer::KeepAliveInterval, 10);
+    QCOMPARE(server.socketOption(QHttpServer::NoDelay), 1);
+    QCOMPARE(server.socketOption(QHttpServer::SendBufferSize), -1);
+
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    QTcpSocket socket;
+    socket.connectToHost(server.serverAddress(), server.serverPort());
+    QTRY_COMPARE(socket.state(), QAbstractSocket::ConnectedState);
+
+    QSimpleHttpClient client(&socket);
+    client.sendHeaders("GET", "/test");
+    QTRY_VERIFY(handler.mSocket != 0);
+
+    // The options are applied to the underlying socket, with keepalive
+    // enabled by setting any of its parameters
+    QTcpSocket *tcpSocket = handler.mSocket->findChild<QTcpSocket*>();
+    QVERIFY(tcpSocket != 0);
+    QCOMPARE(tcpSocket->socketOption(QAbstractSocket::LowDelayOption).toInt(), 1);
+    QCOMPARE(tcpSocket->socketOption(QAbstractSocket::KeepAliveOption).toInt(), 1);
+}
+
 QTEST_MAIN(TestQHttpServer)
 #include "TestQHttpServer.moc"
@@ -33,6 +33,7 @@
 #include "common/qsocketpair.h"
 
 Q_DECLARE_METATYPE(QHttpSocket::QueryStringMap)
+Q_DECLARE_METATYPE(QHttpSocket::Limit)
 
 // Utility macro (avoids duplication) that creates a pair of connected
 // sockets, a QSimpleHttpClient for the client and a QHttpSocket for the
@@ -60,10 +61,23 @@ public:
 private Q_SLOTS:
 
     void testProperties();
+    void testHeaders();
     void testData();
     void testRedirect();
     void testSignals();
     void testJson();
+    void testSpill();
+    void testOutputBuffer();
+    void testPhases();
+
+    void testLimits_data();
+    void testLimits();
+
+    void testTimeouts_data();
+    void testTimeouts();
+
+    void testError_data();
+    void testError();
 
 private:
 
@@ -72,6 +86,8 @@ private:
 
 TestQHttpSocket::TestQHttpSocket()
 {
+    qRegisterMetaType<QHttpSocket::Limit>();
+
     headers.insert("Content-Type", "text/plain");
     headers.insert("Content-Length", QByteArray::number(Data.length()));
 }
@@ -92,7 +108,39 @@ void TestQHttpSocket::testProperties()
 
     QTRY_COMPARE(client.statusCode(), StatusCode);
     QCOMPARE(client.statusReason(), StatusReason);
-    QCOMPARE(client.headers(), headers);
+
+    QHttpSocket::HeaderMap responseHeaders = client.headers();
+    QVERIFY(responseHeaders.take("Date").endsWith(" GMT"));
+    QCOMPARE(responseHeaders.take("Server"), QByteArray("QHttpEngine/" QHTTPENGINE_VERSION));
+    QCOMPARE(responseHeaders, headers);
+}
+
+void TestQHttpSocket::testHeaders()
+{
+    CREATE_SOCKET_PAIR();
+
+    QHttpSocket::HeaderMap headers;
+    headers.insert("Set-Cookie", "c=1");
+    headers.insert("Set-Cookie", "d=2");
+    headers.insert("X-Other", "e");
+    headers.insert("x-other", "f");
+    server.setHeaders(headers);
+
+    server.setHeader("X-Test", "a");
+    server.setHeader("x-test", "b", false);
+    server.setHeader("Set-Cookie", "g=3; Expires=Fri, 01 Jan 2038 00:00:00 GMT", false);
+    server.setHeader("Date", "Thu, 01 Jan 1970 00:00:00 GMT");
+    server.writeHeaders();
+
+    QTRY_COMPARE(client.statusCode(), static_cast<int>(QHttpSocket::OK));
+
+    QHttpSocket::HeaderMap responseHeaders = client.headers();
+    QCOMPARE(responseHeaders.values("X-Test"), QList<QByteArray>() << "a, b");
+    QCOMPARE(responseHeaders.values("X-Other"), QList<QByteArray>() << "e, f");
+    QCOMPARE(responseHeaders.values("Set-Cookie").count(), 3);
+    QVERIFY(responseHeaders.values("Set-Cookie").contains("g=3; Expires=Fri, 01 Jan 2038 00:00:00 GMT"));
+    QCOMPARE(responseHeaders.values("Date"), QList<QByteArray>() << "Thu, 01 Jan 1970 00:00:00 GMT");
+    QCOMPARE(responseHeaders.values("Server").count(), 1);
 }
 
 void TestQHttpSocket::testData()
@@ -184,5 +232,235 @@ void TestQHttpSocket::testJson()
     QCOMPARE(document.object(), object);
 }
 
+void TestQHttpSocket::testSpill()
+{
+    CREATE_SOCKET_PAIR();
+
+    server.setBodySpillThreshold(Data.length() / 2);
+
+    client.sendHeaders(Method, Path, headers);
+    QTRY_VERIFY(server.isHeadersParsed());
+    QVERIFY(server.bodyFileName().isEmpty());
+
+    client.sendData(Data);
+
+    QTRY_COMPARE(server.bytesAvailable(), Data.length());
+    QVERIFY(!server.bodyFileName().isEmpty());
+    QCOMPARE(server.readAll(), Data);
+}
+
+void TestQHttpSocket::testOutputBuffer()
+{
+    CREATE_SOCKET_PAIR();
+
+    server.setHeader("Content-Length", QByteArray::number(Data.length() * 3));
+
+    // Small writes are held until flushed
+    server.write(Data);
+    server.write(Data);
+    QCOMPARE(pair.server()->bytesToWrite(), 0);
+    server.flush();
+    QVERIFY(pair.server()->bytesToWrite() > 0);
+    QTRY_COMPARE(client.data(), Data + Data);
+
+    // ...or until control returns to the event loop
+    server.write(Data);
+    QTRY_COMPARE(client.data(), Data + Data + Data);
+
+    // Failures writing to the socket are reported
+    server.setOutputBufferSize(0);
+    pair.server()->abort();
+    QCOMPARE(server.write(Data), Q_INT64_C(-1));
+}
+
+void TestQHttpSocket::testPhases()
+{
+    CREATE_SOCKET_PAIR();
+
+    QSignalSpy requestCompletedSpy(&server, SIGNAL(requestCompleted()));
+
+    QVERIFY(server.phaseTime(QHttpSocket::AcceptedPhase) >= 0);
+    QCOMPARE(server.phaseTime(QHttpSocket::HeadersParsedPhase), -1);
+
+    client.sendHeaders(Method, Path);
+    QTRY_VERIFY(server.isHeadersParsed());
+
+    server.setHeader("Content-Length", QByteArray::number(Data.length()));
+    server.write(Data);
+    server.close();
+
+    QTRY_COMPARE(requestCompletedSpy.count(), 1);
+    QCOMPARE(client.data(), Data);
+
+    // Phases that were reached must be in order
+    QList<QHttpSocket::Phase> phases = QList<QHttpSocket::Phase>()
+            << QHttpSocket::AcceptedPhase
+            << QHttpSocket::FirstByteReceivedPhase
+            << QHttpSocket::HeadersParsedPhase
+            << QHttpSocket::FirstByteSentPhase
+            << QHttpSocket::LastByteSentPhase;
+    qint64 previous = 0;
+    foreach (QHttpSocket::Phase phase, phases) {
+        QVERIFY(server.phaseTime(phase) >= previous);
+        previous = server.phaseTime(phase);
+    }
+
+    // No handler was involved
+    QCOMPARE(server.phaseTime(QHttpSocket::DispatchedPhase), -1);
+    QCOMPARE(server.phaseTime(QHttpSocket::HandlerReturnedPhase), -1);
+}
+
+void TestQHttpSocket::testLimits_data()
+{
+    QTest::addColumn<int>("limit");
+    QTest::addColumn<qint64>("value");
+    QTest::addColumn<int>("statusCode");
+
+    QTest::newRow("header size")
+            << static_cast<int>(QHttpSocket::MaxHeaderSize)
+            << Q_INT64_C(16)
+            << static_cast<int>(QHttpSocket::RequestHeaderFieldsTooLarge);
+
+    QTest::newRow("header count")
+            << static_cast<int>(QHttpSocket::MaxHeaderCount)
+            << Q_INT64_C(1)
+            << static_cast<int>(QHttpSocket::RequestHeaderFieldsTooLarge);
+
+    QTest::newRow("URI length")
+            << static_cast<int>(QHttpSocket::MaxUriLength)
+            << Q_INT64_C(2)
+            << static_cast<int>(QHttpSocket::UriTooLong);
+
+    QTest::newRow("body size")
+            << static_cast<int>(QHttpSocket::MaxBodySize)
+            << Q_INT64_C(2)
+            << static_cast<int>(QHttpSocket::PayloadTooLarge);
+
+    QTest::newRow("within limit")
+            << static_cast<int>(QHttpSocket::MaxBodySize)
+            << static_cast<qint64>(Data.length())
+            << 0;
+}
+
+void TestQHttpSocket::testLimits()
+{
+    QFETCH(int, limit);
+    QFETCH(qint64, value);
+    QFETCH(int, statusCode);
+
+    CREATE_SOCKET_PAIR();
+
+    server.setLimit(static_cast<QHttpSocket::Limit>(limit), value);
+    QSignalSpy limitExceededSpy(&server, SIGNAL(limitExceeded(QHttpSocket::Limit)));
+    QSignalSpy headersParsedSpy(&server, SIGNAL(headersParsed()));
+
+    client.sendHeaders(Method, Path, headers);
+
+    if (statusCode) {
+        QTRY_COMPARE(client.statusCode(), statusCode);
+        QCOMPARE(limitExceededSpy.count(), 1);
+        QCOMPARE(headersParsedSpy.count(), 0);
+    } else {
+        QTRY_VERIFY(server.isHeadersParsed());
+        QCOMPARE(limitExceededSpy.count(), 0);
+    }
+}
+
+void TestQHttpSocket::testTimeouts_data()
+{
+    QTest::addColumn<int>("timeout");
+    QTest::addColumn<bool>("sendHeaders");
+
+    QTest::newRow("header")
+            << static_cast<int>(QHttpSocket::HeaderTimeout)
+            << false;
+
+    QTest::newRow("body")
+            << static_cast<int>(QHttpSocket::BodyTimeout)
+            << true;
+
+    QTest::newRow("idle")
+            << static_cast<int>(QHttpSocket::IdleTimeout)
+            << true;
+
+    QTest::newRow("total")
+            << static_cast<int>(QHttpSocket::TotalTimeout)
+            << true;
+}
+
+void TestQHttpSocket::testTimeouts()
+{
+    QFETCH(int, timeout);
+    QFETCH(bool, sendHeaders);
+
+    CREATE_SOCKET_PAIR();
+
+    server.setTimeout(static_cast<QHttpSocket::Timeout>(timeout), 100);
+
+    // The body is never sent, so the headers alone never complete the request
+    if (sendHeaders) {
+        client.sendHeaders(Method, Path, headers);
+        QTRY_VERIFY(server.isHeadersParsed());
+    }
+
+    QTRY_COMPARE(client.statusCode(), static_cast<int>(QHttpSocket::RequestTimeout));
+    QCOMPARE(client.statusReason(), QByteArray("REQUEST TIMEOUT"));
+}
+
+void TestQHttpSocket::testError_data()
+{
+    QTest::addColumn<int>("statusCode");
+    QTest::addColumn<QByteArray>("statusReason");
+    QTest::addColumn<bool>("extraHeader");
+
+    QTest::newRow("standard")
+            << static_cast<int>(QHttpSocket::NotFound)
+            << QByteArray("NOT FOUND")
+            << false;
+
+    QTest::newRow("standard with header")
+            << static_cast<int>(QHttpSocket::Unauthorized)
+            << QByteArray("UNAUTHORIZED")
+            << true;
+
+    QTest::newRow("not in enum")
+            << 418
+            << QByteArray("UNKNOWN ERROR")
+            << false;
+
+    QTest::newRow("unknown")
+            << 499
+            << QByteArray("UNKNOWN ERROR")
+            << false;
+}
+
+void TestQHttpSocket::testError()
+{
+    QFETCH(int, statusCode);
+    QFETCH(QByteArray, statusReason);
+    QFETCH(bool, extraHeader);
+
+    QHttpSocket::setErrorTemplate("%1|%2");
+
+    CREATE_SOCKET_PAIR();
+
+    client.sendHeaders(Method, Path);
+    QTRY_VERIFY(server.isHeadersParsed());
+
+    if (extraHeader) {
+        server.setHeader("X-Extra", "value");
+    }
+    server.writeError(statusCode);
+
+    QByteArray body = QByteArray::number(statusCode) + "|" + statusReason;
+    QTRY_COMPARE(client.data(), body);
+    QCOMPARE(client.statusCode(), statusCode);
+    QCOMPARE(client.statusReason(), statusReason);
+    QCOMPARE(client.headers().value("Content-Length").toInt(), body.length());
+    QCOMPARE(client.headers().contains("X-Extra"), extraHeader);
+
+    QHttpSocket::setErrorTemplate(QString());
+}
+
 QTEST_MAIN(TestQHttpSocket)
 #include "TestQHttpSocket.moc"
@@ -22,6 +22,7 @@
 
 #include <QObject>
 #include <QTest>
+#include <QVariantMap>
 
 #include <QHttpEngine/QHttpSocket>
 #include <QHttpEngine/QObjectHandler>
@@ -40,6 +41,9 @@ public Q_SLOTS:
     void valid(QHttpSocket *socket) {
         socket->writeError(QHttpSocket::OK);
     }
+    void validParams(QHttpSocket *socket, const QVariantMap &) {
+        socket->writeError(QHttpSocket::OK);
+    }
 };
 
 class TestQObjectHandler : public QObject
@@ -51,6 +55,9 @@ private Q_SLOTS:
     void testOldConnection_data();
     void testOldConnection();
     void testNewConnection();
+
+    void testTemplates_data();
+    void testTemplates();
 };
 
 void TestQObjectHandler::testOldConnection_data()
@@ -73,6 +80,10 @@ void TestQObjectHandler::testOldConnection_data()
     QTest::newRow("valid")
             << QByteArray(SLOT(valid(QHttpSocket*)))
             << static_cast<int>(QHttpSocket::OK);
+
+    QTest::newRow("valid with parameters")
+            << QByteArray(SLOT(validParams(QHttpSocket*,QVariantMap)))
+            << static_cast<int>(QHttpSocket::OK);
 }
 
 void TestQObjectHandler::testOldConnection()
@@ -129,5 +140,84 @@ void TestQObjectHandler::testNewConnection()
     }
 }
 
+void TestQObjectHandler::testTemplates_data()
+{
+    QTest::addColumn<QByteArray>("path");
+    QTest::addColumn<int>("statusCode");
+    QTest::addColumn<QString>("method");
+    QTest::addColumn<QVariantMap>("params");
+
+    QTest::newRow("literal")
+            << QByteArray("users/list")
+            << static_cast<int>(QHttpSocket::OK)
+            << QString("list")
+            << QVariantMap();
+
+    QTest::newRow("int parameter")
+            << QByteArray("users/123/orders")
+            << static_cast<int>(QHttpSocket::OK)
+            << QString("orders")
+            << QVariantMap{{"id", 123}};
+
+    QTest::newRow("string parameter")
+            << QByteArray("users/abc")
+            << static_cast<int>(QHttpSocket::OK)
+            << QString("user")
+            << QVariantMap{{"name", "abc"}};
+
+    QTest::newRow("invalid int")
+            << QByteArray("users/abc/orders")
+            << static_cast<int>(QHttpSocket::NotFound)
+            << QString()
+            << QVariantMap();
+
+    QTest::newRow("extra segment")
+            << QByteArray("users/123/orders/1")
+            << static_cast<int>(QHttpSocket::NotFound)
+            << QString()
+            << QVariantMap();
+}
+
+void TestQObjectHandler::testTemplates()
+{
+    QFETCH(QByteArray, path);
+    QFETCH(int, statusCode);
+    QFETCH(QString, method);
+    QFETCH(QVariantMap, params);
+
+    QString invokedMethod;
+    QVariantMap invokedParams;
+
+    QObjectHandler handler;
+    handler.registerMethod("users/list", [&invokedMethod](QHttpSocket *socket) {
+        invokedMethod = "list";
+        socket->writeError(QHttpSocket::OK);
+    });
+    handler.registerMethod("users/{id:int}/orders", [&invokedMethod, &invokedParams](QHttpSocket *socket, const QVariantMap &params) {
+        invokedMethod = "orders";
+        invokedParams = params;
+        socket->writeError(QHttpSocket::OK);
+    });
+    handler.registerMethod("users/{name}", [&invokedMethod, &invokedParams](QHttpSocket *socket, const QVariantMap &params) {
+        invokedMethod = "user";
+        invokedParams = params;
+        socket->writeError(QHttpSocket::OK);
+    });
+
+    QSocketPair pair;
+    QTRY_VERIFY(pair.isConnected());
+
+    QSimpleHttpClient client(pair.client());
+    QHttpSocket socket(pair.server(), &pair);
+
+    client.sendHeaders("GET", path);
+    QTRY_VERIFY(socket.isHeadersParsed());
+
+    handler.route(&socket, socket.path());
+    QTRY_COMPARE(client.statusCode(), statusCode);
+    QCOMPARE(invokedMethod, method);
+    QCOMPARE(invokedParams, params);
+}
+
 QTEST_MAIN(TestQObjectHandler)
 #include "TestQObjectHandler.moc"